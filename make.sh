@@ -19,7 +19,7 @@ CIILIBS=`pkg-config --libs cii40`
 
 # compile and link against course software and netpbm library
 CFLAGS="-I. -I/comp/40/include $CIIFLAGS"
-LIBS="$CIILIBS -l40locality -lnetpbm -lm"
+LIBS="$CIILIBS -l40locality -lnetpbm -lm -lpthread"
 LFLAGS="-L/comp/40/lib64 -larith40 -lbitpack"
 
 # these flags max out warnings and debug info
@@ -18,23 +18,59 @@
  *                   a compressed image to stdout, but compresses a PPM and
  *                   decompresses it, printing the resultant PPM to stdout. 
  * 
+ * 
+ *                   -j N compresses or decompresses on N threads. The 
+ *                   output is the same for any N.
+ * 
+ *                   -o DIR codes a batch of files in one run, writing each 
+ *                   one's output into DIR as name.bin (-c) or name.ppm (-d).
+ *                   The files are the rest of the arguments, or, if there 
+ *                   are none, the lines of stdin. With -j N, N files are 
+ *                   coded at a time. 
+ * 
+ *                   --fixed codes with the fixed-point kernels, whose output
+ *                   is the same on every compiler and CPU; it can differ 
+ *                   from the float kernels' by a step of a value where they 
+ *                   round differently. They are scalar, with no SIMD path,
+ *                   so they are for reproducible output, not for speed. 
+ * 
+ *                   --maxval N decompresses to pixmaps with maxval N, 255 
+ *                   (the default) or 65535; at 65535 each sample is two 
+ *                   bytes and keeps what 255 would round away. 
+ * 
+ *                   --serve SOCKET runs as a daemon on a Unix-domain socket,
+ *                   coding requests as they come with threads and buffers 
+ *                   kept warm; see serve40.c for the protocol. 
+ * 
  * Usage:            To compress:    ./40image -c [infile.ppm] > [outfile.bin]
  *                   To decompress:  ./40image -d [infile.bin] > [outfile.ppm]
  *                   To test:        ./40image -t [infile.ppm] > [outfile.ppm]
+ *                   On N threads:   ./40image -j N -c [infile.ppm] > ...
+ *                                   ./40image -j N -d [infile.bin] > ...
+ *                   In a batch:     ./40image [-j N] -c -o outdir a.ppm b.ppm
+ *                                   ls *.bin | ./40image -d -o outdir
+ *                   As a daemon:    ./40image [-j N] --serve /tmp/40image.sock
+ *                   In fixed point: ./40image --fixed -c [infile.ppm] > ...
+ *                   To 16 bits:     ./40image --maxval 65535 -d [in.bin] > ...
  */
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include "assert.h"
 #include <compress40.h>
 
 extern void test40(FILE *input);
+extern int serve40(const char *path);
 static void (*compress_or_decompress)(FILE *input) = compress40;
+static char **read_manifest(FILE *fp, unsigned *nfiles);
 
 int main(int argc, char *argv[])
 {
         int i;
+        const char *outdir = NULL;
+        const char *sock_path = NULL;
 
         for (i = 1; i < argc; i++) {
                 if (strcmp(argv[i], "-c") == 0) {
@@ -43,19 +79,89 @@ int main(int argc, char *argv[])
                         compress_or_decompress = decompress40;
                 } else if (strcmp(argv[i], "-t") == 0) {
                         compress_or_decompress = test40;                        
+                } else if (strcmp(argv[i], "-j") == 0) {
+                        int n = i + 1 < argc ? atoi(argv[++i]) : 0;
+                        if (n < 1) {
+                                fprintf(stderr, "%s: -j needs a number of "
+                                        "threads\n", argv[0]);
+                                exit(1);
+                        }
+                        set_threads40(n);
+                } else if (strcmp(argv[i], "-o") == 0) {
+                        if (i + 1 == argc) {
+                                fprintf(stderr, "%s: -o needs a directory\n",
+                                        argv[0]);
+                                exit(1);
+                        }
+                        outdir = argv[++i];
+                } else if (strcmp(argv[i], "--fixed") == 0) {
+                        set_fixed40(true);
+                } else if (strcmp(argv[i], "--maxval") == 0) {
+                        int n = i + 1 < argc ? atoi(argv[++i]) : 0;
+                        if (n != 255 && n != 65535) {
+                                fprintf(stderr, "%s: --maxval needs 255 or "
+                                        "65535\n", argv[0]);
+                                exit(1);
+                        }
+                        set_maxval40(n);
+                } else if (strcmp(argv[i], "--serve") == 0) {
+                        if (i + 1 == argc) {
+                                fprintf(stderr, "%s: --serve needs a socket "
+                                        "path\n", argv[0]);
+                                exit(1);
+                        }
+                        sock_path = argv[++i];
                 } else if (*argv[i] == '-') {
                         fprintf(stderr, "%s: unknown option '%s'\n",
                                 argv[0], argv[i]);
                         exit(1);
-                } else if (argc - i > 2) {
-                        fprintf(stderr, "Usage: %s -d [filename]\n"
-                                "       %s -c [filename]\n",
-                                argv[0], argv[0]);
+                } else if (argc - i > 2 && outdir == NULL) {
+                        fprintf(stderr, "Usage: %s [-j N] -d [filename]\n"
+                                "       %s [-j N] -c [filename]\n"
+                                "       %s [-j N] -c|-d -o dir "
+                                "[filename ...]\n"
+                                "       %s [-j N] --serve socket\n",
+                                argv[0], argv[0], argv[0], argv[0]);
                         exit(1);
                 } else {
                         break;
                 }
         }
+
+        if (sock_path != NULL) {
+                if (outdir != NULL || i < argc) {
+                        fprintf(stderr, "%s: --serve takes no files\n", 
+                                argv[0]);
+                        exit(1);
+                }
+                int status = serve40(sock_path);
+                release40();
+                return status;
+        }
+
+        if (outdir != NULL) {
+                if (compress_or_decompress == test40) {
+                        fprintf(stderr, "%s: -t takes one file, not -o\n", 
+                                argv[0]);
+                        exit(1);
+                }
+                unsigned nfiles = argc - i;
+                char **files = argv + i;
+                if (nfiles == 0) {
+                        files = read_manifest(stdin, &nfiles);
+                }
+                unsigned failed = batch40(compress_or_decompress 
+                                          == compress40, files, nfiles, outdir);
+                if (files != argv + i) {
+                        for (unsigned k = 0; k < nfiles; k++) {
+                                free(files[k]);
+                        }
+                        free(files);
+                }
+                release40();
+                return failed == 0 ? 0 : 1;
+        }
+
         assert(argc - i <= 1);    /* at most one file on command line */
         if (i < argc) {
                 FILE *fp = fopen(argv[i], "r");
@@ -65,4 +171,50 @@ int main(int argc, char *argv[])
         } else {
                 compress_or_decompress(stdin);
         }
+        release40();
+}
+
+
+/* Reads one file name per line, skipping blank lines, into a malloc'd
+ * array of malloc'd strings. 
+ */
+static char **read_manifest(FILE *fp, unsigned *nfiles)
+{
+        unsigned n = 0, cap = 16;
+        char **files = malloc(cap * sizeof(*files));
+        assert(files != NULL);
+
+        int c = getc(fp);
+        while (c != EOF) {
+                size_t len = 0, size = 64;
+                char *name = malloc(size);
+                assert(name != NULL);
+                for (; c != EOF && c != '\n'; c = getc(fp)) {
+                        if (len + 1 == size) {
+                                size *= 2;
+                                name = realloc(name, size);
+                                assert(name != NULL);
+                        }
+                        name[len++] = c;
+                }
+                c = getc(fp);   /* past the newline */
+                if (len > 0 && name[len - 1] == '\r') {
+                        len--;
+                }
+                name[len] = '\0';
+
+                if (len == 0) {
+                        free(name);
+                        continue;
+                }
+                if (n == cap) {
+                        cap *= 2;
+                        files = realloc(files, cap * sizeof(*files));
+                        assert(files != NULL);
+                }
+                files[n++] = name;
+        }
+
+        *nfiles = n;
+        return files;
 }
@@ -1,6 +1,6 @@
 /* Filename:         bitpack.c
  * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
- * Last Modified:    Mar 1st, 2014
+ * Last Modified:    Oct 17th, 2026
  *
  * Acknowledgements: See README.txt
  *
@@ -10,26 +10,28 @@
  *                   checking whether ints and unsigneds fit within numbers of
  *                   bits, for pulling values of bitfields, and for inserting
  *                   values into bitfields. 
+ *
+ *                   The functions are defined inline in bitpack.h, where 
+ *                   each one's mask is built in constant time; this file 
+ *                   emits the external definitions for callers that don't 
+ *                   inline them.
  */
 
 
 
 #include <stdbool.h>
 #include <stdint.h>
-#include <math.h>
-#include <assert.h>
-#include "except.h"
-#include <bitpack.h>
-#include <stdio.h>
-
-const uint64_t ALL_ONES = 0xFFFFFFFFFFFFFFFF;
-const uint64_t ALL_ZEROS = 0x0000000000000000;
+#include "bitpack.h"
 
-/* shifts val left by n bits */
-static inline uint64_t ushift_l(uint64_t val, unsigned n);
+/* or's one field of each of n words in from a column of values */
+static inline void pack_field(uint32_t *restrict words, 
+                              const int32_t *restrict col, size_t n, 
+                              uint32_t mask, unsigned lsb);
 
-/* shifts val right by n bits */
-static inline uint64_t ushift_r(uint64_t val, unsigned n);
+/* unpacks one field of each of n words into a column of values */
+static inline void unpack_field(const uint32_t *restrict words, 
+                                int32_t *restrict col, size_t n, 
+                                uint32_t mask, unsigned lsb, uint32_t sign);
 
 
 /* Description: Checks if an unsigned value n fits within a bitfield of size 
@@ -38,12 +40,7 @@ static inline uint64_t ushift_r(uint64_t val, unsigned n);
  * Input:       n, a value to check; width, the size of a bitfield.
  * Output:      True if it fits. 
  */
-bool Bitpack_fitsu(uint64_t n, unsigned width)
-{
-        assert(width >= 0 && width <= 64);
-        uint64_t maxval = ushift_l((uint64_t)1, width);
-        return maxval >= n;
-}
+extern inline bool Bitpack_fitsu(uint64_t n, unsigned width);
 
 
 /* Description: Checks if a signed value n fits within a bitfield of size 
@@ -52,13 +49,7 @@ bool Bitpack_fitsu(uint64_t n, unsigned width)
  * Input:       n, a value to check; width, the size of a bitfield.
  * Output:      True if it fits. 
  */
-bool Bitpack_fitss( int64_t n, unsigned width)
-{
-        uint64_t un = (uint64_t) n;
-        assert(width >= 0 && width <= 64);
-        uint64_t maxval = ushift_l((uint64_t)1, width);
-        return un <= maxval;
-}
+extern inline bool Bitpack_fitss(int64_t n, unsigned width);
 
 
 /* Description: Retrieves an unsigned value from a bitfield starting at 
@@ -66,27 +57,10 @@ bool Bitpack_fitss( int64_t n, unsigned width)
  *              
  * Input:       word, the container; width, the size of a bitfield. lsb, the 
  *              location of the bitfield. 
- * Output:      True if it fits. 
+ * Output:      The value of the bitfield. 
  */
-uint64_t Bitpack_getu(uint64_t word, unsigned width, unsigned lsb)
-{
-        assert(width >= 0 && width <= 64);
-        assert(width + lsb < 64);
-        uint64_t mask = ALL_ZEROS;
-
-        if (width == 0) {
-            return 0;
-        }
-
-        for (unsigned i = lsb; i < width + lsb; i++) {
-            mask +=  ushift_l((uint64_t)1, i);
-        }
-
-        uint64_t shift = (uint64_t) (mask & word);
-        shift = ushift_r(shift, lsb);
-
-        return shift;
-}
+extern inline uint64_t Bitpack_getu(uint64_t word, unsigned width, 
+                                                                unsigned lsb);
 
 
 /* Description: Puts an unsigned value into a bitfield in word starting at 
@@ -96,28 +70,8 @@ uint64_t Bitpack_getu(uint64_t word, unsigned width, unsigned lsb)
  *              location of the bitfield, value, the value to store. 
  * Output:      The new word that contains the stored value. 
  */
-uint64_t Bitpack_newu(uint64_t word, unsigned width, unsigned lsb, 
-                                                               uint64_t value)
-{
-        assert(Bitpack_fitsu(value, width));
-        assert(width <= 64);
-        assert(lsb <= 64);
-        assert(lsb + width < 64);
-
-
-        uint64_t mask = ALL_ZEROS;
-
-        for (unsigned i = lsb; i < width + lsb; i++) {
-            mask += ushift_l((uint64_t)1, i);
-        }
-
-        mask = (uint64_t) ~mask;
-
-        uint64_t newword = (uint64_t) (mask & word);
-        uint64_t s_val = (uint64_t) ushift_l(value, lsb);
-        s_val = (uint64_t) s_val | newword;
-        return (uint64_t)(s_val);
-}
+extern inline uint64_t Bitpack_newu(uint64_t word, unsigned width, 
+                                                unsigned lsb, uint64_t value);
 
 
 /* Description: Retrieves a signed value from a bitfield starting at 
@@ -125,27 +79,10 @@ uint64_t Bitpack_newu(uint64_t word, unsigned width, unsigned lsb,
  *              
  * Input:       word, the container; width, the size of a bitfield. lsb, the 
  *              location of the bitfield. 
- * Output:      True if it fits. 
+ * Output:      The bits of the bitfield, as they are stored. 
  */
-int64_t Bitpack_gets(uint64_t word, unsigned width, unsigned lsb)
-{
-        assert(width >= 0 && width <= 64);
-        assert(width + lsb < 64);
-        uint64_t mask = ALL_ZEROS;
-
-        if (width == 0) {
-            return 0;
-        }
-
-        for (unsigned i = lsb; i < width + lsb; i++) {
-            mask +=  ushift_l((uint64_t)1, i);
-        }
-
-        uint64_t shift = (uint64_t) (mask & word);
-        shift = (int64_t)ushift_r(shift, lsb);
-
-        return shift;
-}
+extern inline int64_t Bitpack_gets(uint64_t word, unsigned width, 
+                                                                unsigned lsb);
 
 
 /* Description: Puts a signed value into a bitfield in word starting at 
@@ -155,52 +92,88 @@ int64_t Bitpack_gets(uint64_t word, unsigned width, unsigned lsb)
  *              location of the bitfield, value, the value to store. 
  * Output:      The new word that contains the stored value. 
  */
-uint64_t Bitpack_news(uint64_t word, unsigned width, unsigned lsb, 
-                                                                int64_t value)
-{
+extern inline uint64_t Bitpack_news(uint64_t word, unsigned width, 
+                                                 unsigned lsb, int64_t value);
 
-        assert(Bitpack_fitss(value, width));
-        assert(width <= 64);
-        assert(lsb <= 64);
-        assert(lsb + width < 64);
 
-        uint64_t uval = (uint64_t) value;
+/* Description: Packs n codewords at once from one array of values per 
+ *              field (values[f][i] is field f of word i). Each value is 
+ *              masked to its field's width. Goes a field at a time, so each
+ *              inner loop is one shift and mask over a column that the 
+ *              compiler can vectorize.
+ *              
+ * Input:       Array of n words to fill in, the fields of the word layout
+ *              and a column of n values for each of them.
+ * Output:      None. The words are written to the array.
+ */
+void Bitpack_pack_words(uint32_t *words, size_t n, 
+                        const struct Bitpack_field fields[], 
+                        unsigned nfields, const int32_t *const values[])
+{
+        for (size_t i = 0; i < n; i++) {
+                words[i] = 0;
+        }
 
-        uint64_t mask = ALL_ZEROS;
+        for (unsigned f = 0; f < nfields; f++) {
+                BITPACK_CHECK(fields[f].lsb < 32);
+                BITPACK_CHECK(fields[f].width + fields[f].lsb <= 32);
 
-        for (unsigned i = lsb; i < width + lsb; i++) {
-            mask += ushift_l((uint64_t)1, i);
+                pack_field(words, values[f], n, 
+                           (uint32_t)BITPACK_MASK(fields[f].width), 
+                           fields[f].lsb);
         }
+}
 
-        mask = (uint64_t) ~mask;
 
-        uint64_t newword = (uint64_t) (mask & word);
-        uint64_t s_val = (uint64_t) ushift_l(uval, lsb);
-        s_val = (uint64_t) s_val | newword;
-        // fprintf(stderr, "word : %lu\n", s_val);
-        return (uint64_t)(s_val);
-}
+/* Description: Unpacks n codewords at once into one array of values per 
+ *              field, the reverse of Bitpack_pack_words. Signed fields are
+ *              sign extended; unsigned ones are shifted down and masked.
+ *              
+ * Input:       Array of n words, the fields of the word layout and a column
+ *              of room for n values for each of them.
+ * Output:      None. The values are written to the columns.
+ */
+void Bitpack_unpack_words(const uint32_t *words, size_t n, 
+                          const struct Bitpack_field fields[], 
+                          unsigned nfields, int32_t *const values[])
+{
+        for (unsigned f = 0; f < nfields; f++) {
+                BITPACK_CHECK(fields[f].lsb < 32);
+                BITPACK_CHECK(fields[f].width + fields[f].lsb <= 32);
+                BITPACK_CHECK(fields[f].width > 0 || !fields[f].is_signed);
 
+                uint32_t sign = fields[f].is_signed ? 
+                                (uint32_t)1 << (fields[f].width - 1) : 0;
+
+                unpack_field(words, values[f], n, 
+                             (uint32_t)BITPACK_MASK(fields[f].width), 
+                             fields[f].lsb, sign);
+        }
+}
 
 
-/* shifts val left by n bits, and returns 0 if shifted by 64. */
-static inline uint64_t ushift_l(uint64_t val, unsigned n)
+/* The column loops are kept apart with restrict pointers so that nothing 
+ * stands between them and the vectorizer: each is a shift, a mask and an 
+ * or (or an xor and subtract) across 32-bit lanes.
+ */
+static inline void pack_field(uint32_t *restrict words, 
+                              const int32_t *restrict col, size_t n, 
+                              uint32_t mask, unsigned lsb)
 {
-        if (n >= 64) {
-            return (uint64_t)0;
+        for (size_t i = 0; i < n; i++) {
+                words[i] |= ((uint32_t)col[i] & mask) << lsb;
         }
-        uint64_t newval = val;
-        newval = (uint64_t)(newval << n);
-        return (uint64_t)newval;
 }
 
-/* shifts val right by n bits , and returns 0 if shifted by 64. */
-static inline uint64_t ushift_r(uint64_t val, unsigned n)
+/* flipping the sign bit and subtracting it sign extends; sign is 0 for 
+ * unsigned fields 
+ */
+static inline void unpack_field(const uint32_t *restrict words, 
+                                int32_t *restrict col, size_t n, 
+                                uint32_t mask, unsigned lsb, uint32_t sign)
 {
-        if (n >= 64) {
-            return (uint64_t)0;
+        for (size_t i = 0; i < n; i++) {
+                uint32_t field = (words[i] >> lsb) & mask;
+                col[i] = (int32_t)((field ^ sign) - sign);
         }
-        uint64_t newval = val;
-        newval = (uint64_t)(newval >> n);
-        return (uint64_t)newval;
 }
@@ -0,0 +1,109 @@
+/* Filename:         bitpack.h
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      Header file for BITPACK module. Same interface as the 
+ *                   course's bitpack.h, which this one is found before, 
+ *                   but the functions are C99 inline definitions so callers
+ *                   get plain shifts and masks instead of calls. bitpack.c 
+ *                   holds the external definitions. The BITPACK_ macros are
+ *                   the same operations for fields whose width and lsb are
+ *                   known at compile time. Argument checks are asserts that
+ *                   are only compiled in with -DBITPACK_DEBUG.
+ */
+
+#ifndef BITPACK_INCLUDED
+#define BITPACK_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "except.h"
+
+#ifdef BITPACK_DEBUG
+#include <assert.h>
+#define BITPACK_CHECK(e) assert(e)
+#else
+#define BITPACK_CHECK(e) ((void)0)
+#endif
+
+/* one more than the largest value a field of width bits holds; 0 for 64 */
+#define BITPACK_LIMIT(width) ((uint64_t)((width) < 64) << ((width) & 63))
+
+/* the low width bits set, for any width from 0 to 64 */
+#define BITPACK_MASK(width) (BITPACK_LIMIT(width) - 1)
+
+/* the field of width bits at lsb, shifted down (not sign extended) */
+#define BITPACK_GETU(word, width, lsb) \
+        (((uint64_t)(word) >> (lsb)) & BITPACK_MASK(width))
+#define BITPACK_GETS(word, width, lsb) \
+        ((int64_t)BITPACK_GETU(word, width, lsb))
+
+/* word with its field of width bits at lsb cleared and value or'd in */
+#define BITPACK_NEWU(word, width, lsb, value)                           \
+        (((uint64_t)(word) & ~(BITPACK_MASK(width) << (lsb)))           \
+         | ((uint64_t)(value) << (lsb)))
+#define BITPACK_NEWS(word, width, lsb, value) \
+        BITPACK_NEWU(word, width, lsb, (uint64_t)(int64_t)(value))
+
+inline bool Bitpack_fitsu(uint64_t n, unsigned width)
+{
+        BITPACK_CHECK(width <= 64);
+        return BITPACK_LIMIT(width) >= n;
+}
+
+inline bool Bitpack_fitss(int64_t n, unsigned width)
+{
+        BITPACK_CHECK(width <= 64);
+        return (uint64_t)n <= BITPACK_LIMIT(width);
+}
+
+inline uint64_t Bitpack_getu(uint64_t word, unsigned width, unsigned lsb)
+{
+        BITPACK_CHECK(width + lsb < 64);
+        return BITPACK_GETU(word, width, lsb);
+}
+
+inline int64_t Bitpack_gets(uint64_t word, unsigned width, unsigned lsb)
+{
+        BITPACK_CHECK(width + lsb < 64);
+        return BITPACK_GETS(word, width, lsb);
+}
+
+inline uint64_t Bitpack_newu(uint64_t word, unsigned width, unsigned lsb, 
+                                                               uint64_t value)
+{
+        BITPACK_CHECK(Bitpack_fitsu(value, width));
+        BITPACK_CHECK(width + lsb < 64);
+        return BITPACK_NEWU(word, width, lsb, value);
+}
+
+inline uint64_t Bitpack_news(uint64_t word, unsigned width, unsigned lsb, 
+                                                                int64_t value)
+{
+        BITPACK_CHECK(Bitpack_fitss(value, width));
+        BITPACK_CHECK(width + lsb < 64);
+        return BITPACK_NEWS(word, width, lsb, value);
+}
+
+/* where one field of a 32-bit codeword sits, for the batch functions */
+struct Bitpack_field
+{
+        unsigned width;
+        unsigned lsb;
+        bool     is_signed;     /* sign extended when unpacked */
+};
+
+extern void Bitpack_pack_words(uint32_t *words, size_t n, 
+                               const struct Bitpack_field fields[], 
+                               unsigned nfields, const int32_t *const values[]);
+
+extern void Bitpack_unpack_words(const uint32_t *words, size_t n, 
+                                 const struct Bitpack_field fields[], 
+                                 unsigned nfields, int32_t *const values[]);
+
+extern Except_T Bitpack_Overflow;
+
+#endif
@@ -10,6 +10,8 @@ void check_laws(uint64_t word, unsigned width, unsigned width2, unsigned lsb,
 
 void check_manual();
 
+void check_batch(FILE *randfp);
+
 int main(int argc, char *argv[]) 
 {
 	(void)argc;
@@ -39,6 +41,7 @@ int main(int argc, char *argv[])
 			}
 		}
 	}
+	check_batch(randfp);
 	// check_manual();
 	fprintf(stderr, "%s\n", "Passed.");
 }
@@ -79,4 +82,44 @@ void check_manual()
 	assert(Bitpack_getu(Bitpack_newu(pow(2, 63), 4, 4, 1), 4, 4) == 1);
 }
 
+/* packs random words with the batch functions and checks them against the
+ * single-field ones, then unpacks them again */
+void check_batch(FILE *randfp)
+{
+	enum { N = 100, NFIELDS = 6 };
+	struct Bitpack_field fields[NFIELDS] = {
+		{ 6, 26, false }, { 6, 20, true }, { 6, 14, true },
+		{ 6, 8, true },   { 4, 4, false }, { 4, 0, false }
+	};
+	int32_t cols[NFIELDS][N], back[NFIELDS][N];
+	const int32_t *values[NFIELDS];
+	int32_t *unpacked[NFIELDS];
+	uint32_t words[N];
+
+	for (int f = 0; f < NFIELDS; f++) {
+		size_t rc = fread(cols[f], sizeof(cols[f]), 1, randfp);
+		assert(rc == 1);
+		values[f] = cols[f];
+		unpacked[f] = back[f];
+	}
+
+	Bitpack_pack_words(words, N, fields, NFIELDS, values);
+	Bitpack_unpack_words(words, N, fields, NFIELDS, unpacked);
+
+	for (int i = 0; i < N; i++) {
+		uint64_t word = 0;
+		for (int f = 0; f < NFIELDS; f++) {
+			unsigned w = fields[f].width, lsb = fields[f].lsb;
+			uint64_t field = Bitpack_getu(cols[f][i], w, 0);
+			word = Bitpack_newu(word, w, lsb, field);
+
+			int64_t expect = fields[f].is_signed && field >> (w - 1)
+					 ? (int64_t)field - (1 << w) 
+					 : (int64_t)field;
+			assert(back[f][i] == expect);
+		}
+		assert(words[i] == word);
+	}
+}
+
 
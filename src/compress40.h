@@ -0,0 +1,94 @@
+/* Filename:         compress40.h
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      Interface for the 40image codec. compress40 and 
+ *                   decompress40 are the stream interface the course gives;
+ *                   the rest runs it over many files, over images already
+ *                   in memory, or over a program's own pixel buffers with 
+ *                   no stdio at all. 
+ */
+
+#ifndef COMPRESS40_INCLUDED
+#define COMPRESS40_INCLUDED
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+extern void compress40  (FILE *input);  /* reads PPM, writes compressed image */
+extern void decompress40(FILE *input);  /* reads compressed image, writes PPM */
+
+extern void set_threads40(unsigned n);
+  /* threads every call below codes an image on; 1 to begin with */
+extern void set_fixed40(bool on);
+  /* codes with scalar integer kernels instead of floats, which use AVX2 
+     where they can: the words and pixels are the same on every compiler and
+     CPU, and within one step of any value of the float kernels'; off to 
+     begin with, and -t always uses floats */
+extern void set_maxval40(unsigned maxval);
+  /* denominator decompress40 writes: 255, to begin with, or 65535 for
+     16-bit samples; the buffer API below always makes 8-bit pixels */
+extern void release40(void);
+  /* frees the threads and buffers kept from one image to the next */
+
+extern unsigned batch40(bool compress, char *const files[], unsigned nfiles,
+                                                        const char *outdir);
+  /* codes each file into outdir, a file to a thread; returns how many 
+     were malformed, or could not be opened or written, and were skipped */
+
+extern size_t compress40_bytes(const unsigned char *bytes, size_t len, 
+                                        unsigned char **out, size_t *cap);
+extern size_t decompress40_bytes(const unsigned char *bytes, size_t len, 
+                                        unsigned char **out, size_t *cap);
+  /* code a whole PPM or compressed file in memory into *out, a malloc'd
+     buffer of *cap bytes (or NULL) that is realloc'd to fit; returns the 
+     bytes of output */
+
+
+/* pixel layouts of a caller's buffer, 8 bits a sample */
+enum compress40_format
+{
+        COMPRESS40_RGB8,        /* red, green, blue */
+        COMPRESS40_RGBX8        /* red, green, blue, then a byte that is 
+                                   ignored, and set to 255 on decompression */
+};
+
+/* a caller's pixels: pixel (i, j) starts at pixels + j * stride + i times 
+   the size of a pixel */
+struct compress40_image
+{
+        unsigned width;
+        unsigned height;
+        size_t stride;
+        enum compress40_format format;
+        void *pixels;
+};
+
+extern size_t compress40_words(unsigned width, unsigned height);
+  /* words a width x height image compresses to: one per 2x2 block, a last
+     odd row or column filled out to whole blocks by repeating it */
+extern size_t compress40_buffer(const struct compress40_image *image, 
+                                                          uint32_t *words);
+  /* compresses image into compress40_words(width, height) words, row by 
+     row, in host byte order, and returns how many */
+extern void   decompress40_buffer(const uint32_t *words, unsigned width, 
+                     unsigned height, const struct compress40_image *image);
+  /* decompresses height rows of width words into image, which must be 
+     2 * width x 2 * height pixels, or a column or row less to crop an odd
+     image back to its size */
+
+/* Any of the calls in this file may be made from several threads at once:
+   every one that uses the codec's threads and buffers, or reads or 
+   changes a setting, holds one lock for the whole call, so they take 
+   turns, and a setting changes between images, never during one. 
+
+   The buffer calls use no stdio. It is a checked run-time error to pass 
+   them NULL, a stride shorter than a row, image dimensions that don't 
+   match or are over INT_MAX, or a word with a chroma index past the levels
+   compression makes, which is checked before any work starts. */
+
+#endif
@@ -0,0 +1,443 @@
+/* Filename:         compress40test.c
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      Checks the codec through compress40.h, and 40image's 
+ *                   batch mode through the program itself:
+ *                    - images of odd and even sizes round trip to exactly
+ *                      their size, in format 3 and format 2 respectively;
+ *                    - 1 and 8 threads make the same bytes, with the float 
+ *                      kernels and with the fixed-point ones, which also 
+ *                      round trip;
+ *                    - compress40_buffer and decompress40_buffer, RGB and 
+ *                      RGBX with padded strides, make the words and pixels
+ *                      the in-memory calls do and leave the padding alone;
+ *                    - decompressing to maxval 65535 makes the 8-bit 
+ *                      pixels scaled up;
+ *                    - a batch of three pixmaps, the middle one malformed,
+ *                      on 1 and on 8 threads skips and counts the bad one 
+ *                      and codes the good ones as compress40_bytes does; 
+ *                      then the same for binary images with a cut-short 
+ *                      one; then 40image -j 4 -o with the names on stdin. 
+ *                   Built like bitpacktest, from every object but 
+ *                   40image.o.
+ *
+ *                   Usage: ./compress40test [40image]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <assert.h>
+#include <compress40.h>
+
+const unsigned TEST_THREADS = 8;
+
+static void check_sizes(void);
+static void check_threads(void);
+static void check_buffers(void);
+static void check_buffer_format(enum compress40_format format, 
+                                              size_t pixel, size_t pad);
+static void check_wide(void);
+static void check_batch(unsigned threads);
+static void check_manifest(const char *program);
+static void check_round_trip(const unsigned char *ppm, size_t len, 
+                             const unsigned char *out, size_t out_len);
+static unsigned char *code(bool compress, const unsigned char *bytes, 
+                                             size_t len, size_t *out_len);
+static size_t read_header(const unsigned char *ppm, size_t len, 
+                          unsigned *width, unsigned *height, unsigned *maxval);
+static unsigned char *make_ppm(unsigned width, unsigned height, size_t *len);
+static char *put_file(const char *dir, const char *name, 
+                      const unsigned char *bytes, size_t len);
+static unsigned char *get_file(const char *path, size_t *len);
+static void remove_file(char *path);
+
+int main(int argc, char *argv[])
+{
+        check_sizes();
+        check_threads();
+        check_buffers();
+        check_wide();
+        check_batch(1);
+        check_batch(TEST_THREADS);
+        check_manifest(argc > 1 ? argv[1] : "./40image");
+        fprintf(stderr, "%s\n", "Passed.");
+        return 0;
+}
+
+/* round trips images of odd and even sizes, and checks their headers */
+static void check_sizes(void)
+{
+        static const unsigned sizes[][2] = { 
+                { 1, 1 }, { 2, 2 }, { 31, 17 }, { 33, 48 }, { 64, 3 }, 
+                { 64, 48 }, { 257, 1 } 
+        };
+        for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+                unsigned w = sizes[k][0], h = sizes[k][1];
+                size_t len, bin_len, out_len;
+                unsigned char *ppm = make_ppm(w, h, &len);
+                unsigned char *bin = code(true, ppm, len, &bin_len);
+
+                char want[64];
+                int n;
+                if (w % 2 == 0 && h % 2 == 0) {
+                        n = snprintf(want, sizeof(want), "COMP40 Compressed "
+                                     "image format 2\n%u %u\n", w / 2, h / 2);
+                } else {
+                        n = snprintf(want, sizeof(want), "COMP40 Compressed "
+                                     "image format 3\n%u %u\n", w, h);
+                }
+                assert(memcmp(bin, want, n) == 0);
+                assert(bin_len == n + 4 * compress40_words(w, h));
+
+                unsigned char *out = code(false, bin, bin_len, &out_len);
+                check_round_trip(ppm, len, out, out_len);
+                free(out);
+                free(bin);
+                free(ppm);
+        }
+}
+
+/* codes an image on 1 thread and on TEST_THREADS, with each engine */
+static void check_threads(void)
+{
+        size_t len;
+        unsigned char *ppm = make_ppm(257, 129, &len);
+        for (int fixed = 0; fixed < 2; fixed++) {
+                set_fixed40(fixed);
+                unsigned char *bin[2], *out[2];
+                size_t bin_len[2], out_len[2];
+                for (int k = 0; k < 2; k++) {
+                        set_threads40(k == 0 ? 1 : TEST_THREADS);
+                        bin[k] = code(true, ppm, len, &bin_len[k]);
+                        out[k] = code(false, bin[k], bin_len[k], &out_len[k]);
+                }
+                assert(bin_len[0] == bin_len[1]);
+                assert(memcmp(bin[0], bin[1], bin_len[0]) == 0);
+                assert(out_len[0] == out_len[1]);
+                assert(memcmp(out[0], out[1], out_len[0]) == 0);
+                check_round_trip(ppm, len, out[0], out_len[0]);
+                for (int k = 0; k < 2; k++) {
+                        free(bin[k]);
+                        free(out[k]);
+                }
+        }
+        set_fixed40(false);
+        set_threads40(1);
+        free(ppm);
+}
+
+static void check_buffers(void)
+{
+        check_buffer_format(COMPRESS40_RGB8, 3, 13);
+        check_buffer_format(COMPRESS40_RGBX8, 4, 8);
+}
+
+/* codes an odd-sized image through a caller's buffer of pixel bytes a 
+   pixel, rows pad bytes longer than the pixels, and checks the words and
+   pixels against the in-memory calls' */
+static void check_buffer_format(enum compress40_format format, 
+                                              size_t pixel, size_t pad)
+{
+        const unsigned w = 31, h = 17;
+        const unsigned char fill = 0xa5;
+        size_t len, bin_len, out_len;
+        unsigned char *ppm = make_ppm(w, h, &len);
+        unsigned char *bin = code(true, ppm, len, &bin_len);
+        unsigned char *out = code(false, bin, bin_len, &out_len);
+        unsigned ow, oh, maxval;
+        const unsigned char *samples = ppm + read_header(ppm, len, &ow, &oh,
+                                                                   &maxval);
+        const unsigned char *decoded = out + read_header(out, out_len, &ow, 
+                                                              &oh, &maxval);
+
+        struct compress40_image image = { w, h, w * pixel + pad, format, 
+                                          NULL };
+        unsigned char *pixels = malloc(h * image.stride);
+        assert(pixels != NULL);
+        image.pixels = pixels;
+        memset(pixels, fill, h * image.stride);
+        for (unsigned j = 0; j < h; j++) {
+                for (unsigned i = 0; i < w; i++) {
+                        memcpy(pixels + j * image.stride + i * pixel, 
+                               samples + 3 * ((size_t)j * w + i), 3);
+                }
+        }
+
+        /* the file's words are little-endian, after its two-line header */
+        size_t n = compress40_words(w, h);
+        uint32_t *words = malloc(n * sizeof(*words));
+        assert(words != NULL);
+        assert(compress40_buffer(&image, words) == n);
+        const unsigned char *p = bin + bin_len - 4 * n;
+        for (size_t k = 0; k < n; k++, p += 4) {
+                assert(words[k] == ((uint32_t)p[0] | (uint32_t)p[1] << 8 
+                                    | (uint32_t)p[2] << 16 
+                                    | (uint32_t)p[3] << 24));
+        }
+
+        memset(pixels, fill, h * image.stride);
+        decompress40_buffer(words, (w + 1) / 2, (h + 1) / 2, &image);
+        for (unsigned j = 0; j < h; j++) {
+                const unsigned char *row = pixels + j * image.stride;
+                for (unsigned i = 0; i < w; i++) {
+                        const unsigned char *px = row + i * pixel;
+                        assert(memcmp(px, decoded + 3 * ((size_t)j * w + i),
+                                                                3) == 0);
+                        assert(pixel == 3 || px[3] == 255);
+                }
+                for (size_t b = w * pixel; b < image.stride; b++) {
+                        assert(row[b] == fill);
+                }
+        }
+
+        free(words);
+        free(pixels);
+        free(out);
+        free(bin);
+        free(ppm);
+}
+
+/* decompresses to maxval 65535 and checks the samples against 255's */
+static void check_wide(void)
+{
+        const unsigned w = 31, h = 17;
+        size_t len, bin_len, out_len, wide_len;
+        unsigned char *ppm = make_ppm(w, h, &len);
+        unsigned char *bin = code(true, ppm, len, &bin_len);
+        unsigned char *out = code(false, bin, bin_len, &out_len);
+        set_maxval40(65535);
+        unsigned char *wide = code(false, bin, bin_len, &wide_len);
+        set_maxval40(255);
+
+        unsigned ow, oh, maxval;
+        size_t at = read_header(out, out_len, &ow, &oh, &maxval);
+        size_t wide_at = read_header(wide, wide_len, &ow, &oh, &maxval);
+        assert(ow == w && oh == h && maxval == 65535);
+        assert(wide_len == wide_at + 6 * (size_t)w * h);
+        for (size_t k = 0; k < 3 * (size_t)w * h; k++) {
+                unsigned s = wide[wide_at + 2 * k] << 8 
+                             | wide[wide_at + 2 * k + 1];
+                int narrow = (s * 255 + 32767) / 65535;
+                assert(abs(narrow - out[at + k]) <= 1);
+        }
+
+        free(wide);
+        free(out);
+        free(bin);
+        free(ppm);
+}
+
+/* codes good, bad, good files in a batch, each way, and expects one 
+   failure and the good files' outputs to be what the in-memory calls give */
+static void check_batch(unsigned threads)
+{
+        char dir[] = "/tmp/compress40test.XXXXXX";
+        assert(mkdtemp(dir) != NULL);
+        set_threads40(threads);
+
+        size_t len[2], bin_len[2];
+        unsigned char *ppm[2] = { make_ppm(31, 17, &len[0]), 
+                                  make_ppm(64, 48, &len[1]) };
+        unsigned char *bin[2];
+        for (int k = 0; k < 2; k++) {
+                bin[k] = code(true, ppm[k], len[k], &bin_len[k]);
+        }
+
+        const char bad_ppm[] = "P3\n2 2\n255\n1 2 3 4 5 6 7 8 9\n";
+        char *ppms[3] = { put_file(dir, "a.ppm", ppm[0], len[0]),
+                          put_file(dir, "b.ppm", (const unsigned char *)
+                                           bad_ppm, sizeof(bad_ppm) - 1),
+                          put_file(dir, "c.ppm", ppm[1], len[1]) };
+        assert(batch40(true, ppms, 3, dir) == 1);
+
+        char *bins[3] = { put_file(dir, "a.bin", NULL, 0), 
+                          put_file(dir, "b.bin", bin[1], bin_len[1] - 4), 
+                          put_file(dir, "c.bin", NULL, 0) };
+        for (int k = 0; k < 3; k += 2) {
+                size_t got_len;
+                unsigned char *got = get_file(bins[k], &got_len);
+                assert(got_len == bin_len[k / 2]);
+                assert(memcmp(got, bin[k / 2], got_len) == 0);
+                free(got);
+        }
+
+        /* the cut-short b.bin is skipped, which leaves b.ppm as it was */
+        assert(batch40(false, bins, 3, dir) == 1);
+        for (int k = 0; k < 3; k += 2) {
+                size_t want_len, got_len;
+                unsigned char *want = code(false, bin[k / 2], bin_len[k / 2],
+                                                                  &want_len);
+                unsigned char *got = get_file(ppms[k], &got_len);
+                assert(got_len == want_len);
+                assert(memcmp(got, want, got_len) == 0);
+                free(got);
+                free(want);
+        }
+
+        for (int k = 0; k < 3; k++) {
+                remove_file(ppms[k]);
+                remove_file(bins[k]);
+        }
+        for (int k = 0; k < 2; k++) {
+                free(ppm[k]);
+                free(bin[k]);
+        }
+        assert(rmdir(dir) == 0);
+        set_threads40(1);
+}
+
+/* runs program -j 4 -c -o on pixmaps named on its stdin, and expects 
+   what compress40_bytes makes of each */
+static void check_manifest(const char *program)
+{
+        char dir[] = "/tmp/compress40test.XXXXXX";
+        assert(mkdtemp(dir) != NULL);
+        size_t len[3], bin_len[3];
+        unsigned char *ppm[3] = { make_ppm(31, 17, &len[0]), 
+                                  make_ppm(64, 48, &len[1]),
+                                  make_ppm(2, 5, &len[2]) };
+        char *ppms[3] = { put_file(dir, "a.ppm", ppm[0], len[0]),
+                          put_file(dir, "b.ppm", ppm[1], len[1]),
+                          put_file(dir, "c.ppm", ppm[2], len[2]) };
+        char *bins[3] = { put_file(dir, "a.bin", NULL, 0), 
+                          put_file(dir, "b.bin", NULL, 0), 
+                          put_file(dir, "c.bin", NULL, 0) };
+
+        char *command = malloc(strlen(program) + strlen(dir) + 32);
+        assert(command != NULL);
+        sprintf(command, "%s -j 4 -c -o %s", program, dir);
+        FILE *names = popen(command, "w");
+        assert(names != NULL);
+        for (int k = 0; k < 3; k++) {
+                fprintf(names, "%s\n", ppms[k]);
+        }
+        int status = pclose(names);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+        for (int k = 0; k < 3; k++) {
+                size_t got_len;
+                unsigned char *want = code(true, ppm[k], len[k], &bin_len[k]);
+                unsigned char *got = get_file(bins[k], &got_len);
+                assert(got_len == bin_len[k]);
+                assert(memcmp(got, want, got_len) == 0);
+                free(got);
+                free(want);
+                free(ppm[k]);
+                remove_file(ppms[k]);
+                remove_file(bins[k]);
+        }
+        free(command);
+        assert(rmdir(dir) == 0);
+}
+
+/* checks that a decompressed pixmap is exactly the size of the original,
+   with maxval 255; the codec is too lossy for its samples to be checked */
+static void check_round_trip(const unsigned char *ppm, size_t len, 
+                             const unsigned char *out, size_t out_len)
+{
+        unsigned w, h, ow, oh, maxval;
+        size_t at = read_header(ppm, len, &w, &h, &maxval);
+        size_t out_at = read_header(out, out_len, &ow, &oh, &maxval);
+        assert(ow == w && oh == h && maxval == 255);
+        assert(out_len - out_at == len - at);
+}
+
+/* compresses or decompresses bytes into a new buffer */
+static unsigned char *code(bool compress, const unsigned char *bytes, 
+                                             size_t len, size_t *out_len)
+{
+        unsigned char *out = NULL;
+        size_t cap = 0;
+        if (compress) {
+                *out_len = compress40_bytes(bytes, len, &out, &cap);
+        } else {
+                *out_len = decompress40_bytes(bytes, len, &out, &cap);
+        }
+        return out;
+}
+
+/* reads the header of a P6 pixmap and returns where its samples start */
+static size_t read_header(const unsigned char *ppm, size_t len, 
+                          unsigned *width, unsigned *height, unsigned *maxval)
+{
+        char header[64];
+        size_t n = len < sizeof(header) - 1 ? len : sizeof(header) - 1;
+        memcpy(header, ppm, n);
+        header[n] = '\0';
+        int at = 0;
+        assert(sscanf(header, "P6 %u %u %u%n", width, height, maxval, &at) 
+                                                                   == 3);
+        return at + 1;
+}
+
+/* a width x height PPM of a smooth gradient, with a step every 64 or 128 
+   pixels */
+static unsigned char *make_ppm(unsigned width, unsigned height, size_t *len)
+{
+        char header[64];
+        int n = snprintf(header, sizeof(header), "P6\n%u %u\n255\n",
+                                                         width, height);
+        *len = n + 3 * (size_t)width * height;
+        unsigned char *ppm = malloc(*len);
+        assert(ppm != NULL);
+        memcpy(ppm, header, n);
+
+        unsigned char *p = ppm + n;
+        for (unsigned j = 0; j < height; j++) {
+                for (unsigned i = 0; i < width; i++) {
+                        *p++ = 64 + i % 128;
+                        *p++ = 64 + j % 128;
+                        *p++ = 96 + (i + j) % 64;
+                }
+        }
+        return ppm;
+}
+
+/* writes len bytes to dir/name, if there are any, and returns its path */
+static char *put_file(const char *dir, const char *name, 
+                      const unsigned char *bytes, size_t len)
+{
+        char *path = malloc(strlen(dir) + strlen(name) + 2);
+        assert(path != NULL);
+        sprintf(path, "%s/%s", dir, name);
+        if (bytes != NULL) {
+                FILE *fp = fopen(path, "wb");
+                assert(fp != NULL);
+                assert(fwrite(bytes, 1, len, fp) == len);
+                assert(fclose(fp) == 0);
+        }
+        return path;
+}
+
+/* reads the whole of a file into a new buffer */
+static unsigned char *get_file(const char *path, size_t *len)
+{
+        FILE *fp = fopen(path, "rb");
+        assert(fp != NULL);
+        assert(fseek(fp, 0, SEEK_END) == 0);
+        long size = ftell(fp);
+        assert(size >= 0);
+        rewind(fp);
+        unsigned char *bytes = malloc(size + 1);
+        assert(bytes != NULL);
+        assert(fread(bytes, 1, size, fp) == (size_t)size);
+        fclose(fp);
+        *len = size;
+        return bytes;
+}
+
+static void remove_file(char *path)
+{
+        unlink(path);
+        free(path);
+}
@@ -0,0 +1,79 @@
+/* Filename:         mapfile.c
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      MAPFILE is a module that maps what is left of an input 
+ *                   file into memory read only, so a decoder can work 
+ *                   straight out of the page cache instead of copying the 
+ *                   file through stdio. Only regular files can be mapped; 
+ *                   callers fall back on reading pipes and terminals.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "assert.h"
+#include "mapfile.h"
+
+
+/* Description: Maps a file from its current position to its end, and 
+ *              tells the kernel it will be read through in order. 
+ *              
+ * Input:       Open file that nothing has been read from through stdio 
+ *              since it was positioned, and the mapped_file to fill in. 
+ *              CRE for either to be NULL.
+ * Output:      True if the file was mapped. False if it isn't a nonempty 
+ *              regular file or can't be mapped, in which case it should be
+ *              read as a stream and map is left alone.
+ */
+bool map_file(FILE *fp, struct mapped_file *map)
+{
+        assert(fp != NULL && map != NULL);
+
+        struct stat st;
+        int fd = fileno(fp);
+        if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+                return false;
+        }
+
+        long offset = ftell(fp);
+        if (offset < 0 || (uintmax_t)st.st_size <= (uintmax_t)offset 
+                       || (uintmax_t)st.st_size > SIZE_MAX) {
+                return false;
+        }
+
+        size_t map_len = st.st_size;
+        void *base = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) {
+                return false;
+        }
+        posix_madvise(base, map_len, POSIX_MADV_SEQUENTIAL);
+
+        map->base = base;
+        map->map_len = map_len;
+        map->bytes = (const unsigned char *)base + offset;
+        map->len = map_len - offset;
+        return true;
+}
+
+
+/* Description: Unmaps a file mapped by map_file. 
+ *              
+ * Input:       Pointer to the mapped_file. CRE for it to be NULL. 
+ * Output:      None. The bytes it pointed to are no longer valid. 
+ */
+void unmap_file(struct mapped_file *map)
+{
+        assert(map != NULL);
+        munmap(map->base, map->map_len);
+        map->base = NULL;
+        map->bytes = NULL;
+        map->len = map->map_len = 0;
+}
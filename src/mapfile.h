@@ -0,0 +1,30 @@
+/* Filename:         mapfile.h
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      Header file for MAPFILE module. 
+ */
+
+#ifndef MAPFILE
+#define MAPFILE
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* the rest of an open file, from its current position, mapped into memory */
+struct mapped_file
+{
+        const unsigned char *bytes;
+        size_t len;
+        void *base;             /* start of the mapping, for unmap_file */
+        size_t map_len;
+};
+
+extern bool map_file(FILE *fp, struct mapped_file *map);
+
+extern void unmap_file(struct mapped_file *map);
+
+#endif
@@ -1,25 +1,41 @@
 /* Filename:         packpix.c
  * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
- * Last Modified:    Mar 1st, 2014
+ * Last Modified:    Oct 17th, 2026
  *
  * Acknowledgements: See README.txt
  *
- * Description:      PACKPIX is a module that implements functions which turn
- *                   UArray2bs of component-video pixels into blockwise 
- *                   averages for 2x2 blocks of component video pixels, 
- *                   quantizes the averages to indices, then packs the 
- *                   quantized indicies into 32-bit words which are stored in 
- *                   a Hanson UArray2_T. Reverse to decompress. 
+ * Description:      PACKPIX turns 2x2 blocks of pixels into 32-bit words and
+ *                   back. Each block is converted to component video, 
+ *                   averaged, quantized to indices and packed into a word;
+ *                   decompression reverses each step. 
+ *
+ *                   The codec works a pair of scanlines at a time, in fused
+ *                   kernels that go straight from RGB rows to a row of 
+ *                   words and back: rgb_rows_to_words and words_to_rgb_rows
+ *                   (or words_to_rgb16_rows for 16-bit output), with float 
+ *                   arithmetic, using simd.c's AVX2 kernels where the CPU 
+ *                   has them, and scalar _fixed versions in integers whose 
+ *                   output is the same everywhere. Chroma is quantized with
+ *                   tables built once. words_valid checks a batch of words 
+ *                   before any is unpacked. 
+ *
+ *                   comp_vid_to_word and word_to_comp_vid are the original
+ *                   tiers, over UArray2bs of component video and a UArray2
+ *                   of words; only -t still uses them. 
  */
 
 
 #include "packpix.h"
+#include "rgbconvert.h"
+#include "simd.h"
 #include "bitpack.h"
 #include "uarray2.h"
 #include "uarray.h"
 #include "pnm.h"
 #include "types.h"
 #include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include <assert.h>
 #include <arith40.h>
 #include <math.h>
@@ -66,28 +82,149 @@ const int LSB_PR = 0;
 const int ABCD_WIDTH = 6;
 const int PRPB_WIDTH = 4;
 
+/* number of blocks whose quantized values are packed or unpacked at once */
+#define PACK_CHUNK 64
 
-static inline void clip_float_cv(struct float_comp_vid *fcv);
-static inline void clip_quant(struct quant_comp_vid *qcv);
-static inline void clip_cv(struct comp_vid *cv);
+/* quantized values of up to PACK_CHUNK blocks, a column for each field */
+struct quant_cols
+{
+        int32_t a[PACK_CHUNK];
+        int32_t b[PACK_CHUNK];
+        int32_t c[PACK_CHUNK];
+        int32_t d[PACK_CHUNK];
+        int32_t qpb[PACK_CHUNK];
+        int32_t qpr[PACK_CHUNK];
+};
+
+/* the words keep every other index of the course's chroma table, so there 
+ * are 8 levels of chroma; these are looked up instead of calling arith40 for
+ * every block, and built from it once, the first time they are needed
+ */
+#define CHROMA_LEVELS 8
+static pthread_once_t chroma_once = PTHREAD_ONCE_INIT;
+static float chroma_of_level[CHROMA_LEVELS];
+static float chroma_bound[CHROMA_LEVELS];
+static struct chroma_terms pb_terms_of_level[CHROMA_LEVELS];
+static struct chroma_terms pr_terms_of_level[CHROMA_LEVELS];
+static struct chroma_terms pb16_terms_of_level[CHROMA_LEVELS];
+static struct chroma_terms pr16_terms_of_level[CHROMA_LEVELS];
+
+/* the fixed-point engine does the same sums in integers, with the decimal 
+ * coefficients of rgbconvert.c: luma in thousandths, chroma and the inverse 
+ * conversion in millionths 
+ */
+const int32_t FIX_Y_R =     299;
+const int32_t FIX_Y_G =     587;
+const int32_t FIX_Y_B =     114;
+const int64_t FIX_PB_R = -168736;
+const int64_t FIX_PB_G = -331264;
+const int64_t FIX_PB_B =  500000;
+const int64_t FIX_PR_R =  500000;
+const int64_t FIX_PR_G = -418688;
+const int64_t FIX_PR_B =  -81312;
+const int64_t FIX_R_PR = 1402000;
+const int64_t FIX_G_PB = -344136;
+const int64_t FIX_G_PR = -714136;
+const int64_t FIX_B_PB = 1772000;
+
+/* decoded luma is a count of 1/FIX_LUM_UNITS, which a over A_QUANT_FACTOR, 
+ * b, c and d over QUANT_FACTOR, and the 0.3 they are clipped to all are; 
+ * decoded samples are numerators over FIX_DEN, which both luma and a 
+ * coefficient times a chroma in millionths divide, times the denominator 
+ */
+const int32_t FIX_LUM_UNITS = 163520;
+const int32_t FIX_A_UNIT    = 320;
+const int32_t FIX_BCD_UNIT  = 2555;
+const int32_t FIX_BCD_BOUND = 49056;
+const int64_t FIX_DEN       = 511000000000000;
+const int64_t FIX_LUM_SCALE = 3125000000;      /* FIX_DEN / units */
+const int64_t FIX_CHROMA_SCALE = 511;          /* FIX_DEN / 10^12 */
+
+/* the factor both output denominators share with FIX_DEN; cancelling it 
+ * keeps a numerator times RGB16_DENOM within 64 bits 
+ */
+const uint64_t FIX_DEN_FACTOR = 5;
 
-void apply_block_to_float(int i, int j, UArray2b_T cv_array, void *elem, 
-                                                           void *arr_closure);
+/* each chroma bound exactly, as fix_bound_num[q] over 2^fix_bound_shift[q]
+ * millionths of a sum of four chromas, from which the bounds for a 
+ * denominator are worked out in integers 
+ */
+static int64_t fix_bound_num[CHROMA_LEVELS];
+static int fix_bound_shift[CHROMA_LEVELS];
 
-void apply_float_to_quant(int i, int j, UArray2_T fcv_array, void *elem, 
-                                                                    void *cl);
+/* the bounds for the last denominator a thread packed in fixed point, kept
+ * for each thread so that they are worked out once per denominator, not 
+ * once per row 
+ */
+struct fix_bounds
+{
+        int denom;
+        int64_t bound[CHROMA_LEVELS];
+};
+static pthread_once_t fix_bounds_once = PTHREAD_ONCE_INIT;
+static pthread_key_t fix_bounds_key;
 
-void apply_quant_pack(int i, int j, UArray2_T qcv_array, void *elem, 
-                                                                    void *cl);
+/* per chroma level, its part of a decoded sample over FIX_DEN */
+static int64_t fix_red_of_pr[CHROMA_LEVELS];
+static int64_t fix_green_of_pb[CHROMA_LEVELS];
+static int64_t fix_green_of_pr[CHROMA_LEVELS];
+static int64_t fix_blue_of_pb[CHROMA_LEVELS];
 
-void apply_quant_unpack(int i, int j, UArray2_T pack_array, void *elem, 
-                                                                    void *cl);
 
-void apply_quant_to_float(int i, int j, UArray2_T qcv_array, void *elem, 
-                                                                    void *cl);
+static inline void clip_float_cv(struct float_comp_vid *fcv);
+static inline void clip_quant(struct quant_comp_vid *qcv);
+static inline void clip_cv(struct comp_vid *cv);
 
-void apply_float_to_block(int i, int j, UArray2_T fcv_array,  
-                                                  void *elem, void *arr2b_cl);
+static inline uint32_t block_to_word(struct Pnm_rgb tl, struct Pnm_rgb tr, 
+                        struct Pnm_rgb bl, struct Pnm_rgb br, double scale);
+static inline struct float_comp_vid block_to_float(struct comp_vid cv[]);
+static inline struct quant_comp_vid float_to_quant(struct float_comp_vid fcv);
+static inline struct quant_comp_vid luma_to_quant(struct float_comp_vid fcv);
+static void build_chroma_tables(void);
+static unsigned arith_level_of_chroma(float x);
+static inline unsigned chroma_to_level(float x);
+static inline uint32_t quant_pack(struct quant_comp_vid qcv);
+static inline struct quant_comp_vid quant_unpack(uint32_t word);
+static inline struct float_comp_vid quant_to_float(struct quant_comp_vid qcv);
+static inline void float_to_block(struct float_comp_vid fcv, 
+                                                        struct comp_vid cv[]);
+static inline void word_to_pixels(uint32_t word, bool wide, 
+                                  struct Pnm_rgb *tl, struct Pnm_rgb *tr,
+                                  struct Pnm_rgb *bl, struct Pnm_rgb *br);
+static void words_to_rows(const uint32_t *words, int width, 
+                          unsigned char *top, unsigned char *bottom, 
+                          bool wide);
+static inline void put_rgb(unsigned char *scanline, int i, 
+                                                        struct Pnm_rgb pix);
+static inline void put_rgb16(unsigned char *scanline, int i, 
+                                                        struct Pnm_rgb pix);
+static const int64_t *fix_chroma_bounds(int denom);
+static void make_fix_bounds_key(void);
+static inline int64_t fix_ceil_shift(int64_t n, int shift);
+static inline uint32_t fix_block_to_word(struct Pnm_rgb tl, 
+                         struct Pnm_rgb tr, struct Pnm_rgb bl, 
+                         struct Pnm_rgb br, int32_t scale, 
+                         const int64_t bounds[]);
+static inline int32_t fix_luma(struct Pnm_rgb pix);
+static inline int32_t fix_coef(int32_t sum, int32_t scale);
+static inline unsigned fix_chroma_level(int64_t sum, const int64_t bounds[]);
+static inline void fix_word_to_rgb_block(uint32_t word, int i, 
+                                         unsigned char *top,
+                                         unsigned char *bottom, bool wide);
+static inline int32_t fix_dequant_coef(int32_t q);
+static inline void fix_put_pixel(unsigned char *scanline, int i, int32_t lum,
+                                 int64_t red, int64_t green, int64_t blue, 
+                                 bool wide);
+static inline unsigned fix_sample(int64_t numerator, int denom);
+
+static void quant_arr_pack(UArray2_T quant_arr, UArray2_T word_arr);
+static void quant_arr_unpack(UArray2_T word_arr, UArray2_T quant_arr);
+static inline void put_quant(struct quant_cols *cols, int k, 
+                                                struct quant_comp_vid qcv);
+static inline struct quant_comp_vid get_quant(const struct quant_cols *cols,
+                                                                       int k);
+static void pack_cols(const struct quant_cols *cols, int n, uint32_t *words);
+static void unpack_cols(const uint32_t *words, int n, struct quant_cols *cols);
 
 
 
@@ -95,37 +232,50 @@ void apply_float_to_block(int i, int j, UArray2_T fcv_array,
 
 
 /* Description: Converts a pixelwise component video array into an array of 
- *              32-bit words, using a series of apply functions. 
+ *              32-bit words, a stage at a time: each stage runs along the 
+ *              rows of the last one's array into a new one. Blocks cut off 
+ *              by an odd edge are coded whole, so their unused cells must 
+ *              have been filled in, as rgb_to_comp_vid does.
  *              
  * Input:       UArray2b of component video pixels.
  * Output:      UArray2 of 32 bit words, each representing a 2x2 pixel block.
  */
 UArray2_T comp_vid_to_word(UArray2b_T cv_array)
 {
-        /*make a target array of blockwise component video structs for map */
-        UArray2_T avg_float_arr = 
-                            UArray2_new(cv_array->width / cv_array->blocksize, 
-                                       cv_array->height / cv_array->blocksize, 
-                                               sizeof(struct float_comp_vid));
-        UArray2_map_row_major(cv_array->blocks, 
-                      &apply_block_to_float, avg_float_arr);
+        int bs = cv_array->blocksize;
+        int width = (cv_array->width + bs - 1) / bs;
+        int height = (cv_array->height + bs - 1) / bs;
+        pthread_once(&chroma_once, build_chroma_tables);
 
+        /*make a target array of blockwise component video structs */
+        UArray2_T avg_float_arr = UArray2_new(width, height, 
+                                               sizeof(struct float_comp_vid));
+        for (int j = 0; j < height; j++) {
+                struct float_comp_vid *fcv = UArray2_row_ptr(avg_float_arr, j);
+                //a row's blocks follow each other, each in cell order
+                struct comp_vid *block = UArray2b_block(cv_array, 0, j);
+                for (int i = 0; i < width; i++, block += BLOCK_LEN) {
+                        fcv[i] = block_to_float(block);
+                }
+        }
 
-        /*make a target array of quant_component video structs for map */
-        UArray2_T quant_arr = 
-                            UArray2_new(cv_array->width / cv_array->blocksize,
-                                       cv_array->height / cv_array->blocksize,
+        /*make a target array of quant_component video structs */
+        UArray2_T quant_arr = UArray2_new(width, height, 
                                                sizeof(struct quant_comp_vid));
-        UArray2_map_row_major(avg_float_arr, &apply_float_to_quant,quant_arr);
+        for (int j = 0; j < height; j++) {
+                struct float_comp_vid *fcv = UArray2_row_ptr(avg_float_arr, j);
+                struct quant_comp_vid *qcv = UArray2_row_ptr(quant_arr, j);
+                for (int i = 0; i < width; i++) {
+                        qcv[i] = float_to_quant(fcv[i]);
+                }
+        }
 
         UArray2_free(&avg_float_arr);
 
         /*make a target array of 32 bit words where we'll store final data */
-        UArray2_T word_arr =UArray2_new(cv_array->width / cv_array->blocksize,
-                                       cv_array->height / cv_array->blocksize,
-                                                           sizeof(unsigned*));
+        UArray2_T word_arr = UArray2_new(width, height, sizeof(uint32_t));
 
-        UArray2_map_row_major(quant_arr, &apply_quant_pack, word_arr);
+        quant_arr_pack(quant_arr, word_arr);
 
         UArray2_free(&quant_arr);
 
@@ -133,37 +283,56 @@ UArray2_T comp_vid_to_word(UArray2b_T cv_array)
 }
 
 /* Description: Converts a UArray2 of 32 bit words into a Uarray2b of compnent
- *              video pixels. 
+ *              video pixels, the reverse of comp_vid_to_word. The cells of
+ *              the last column or row of blocks past an odd edge are 
+ *              decoded into the UArray2b's unused cells, which crops them.
  *              
- * Input:       UArray2 of 32 bit words, each representing a 2x2 pixel block.
+ * Input:       UArray2 of 32 bit words, each representing a 2x2 pixel 
+ *              block, and the width and height of the image in pixels. CRE
+ *              for them to need a different number of blocks.
  * Output:      UArray2b of component video pixels.
  */
-UArray2b_T word_to_comp_vid(UArray2_T word_arr)
+UArray2b_T word_to_comp_vid(UArray2_T word_arr, int pix_width, 
+                                                int pix_height)
 {
+        int width = word_arr->width;
+        int height = word_arr->height;
+        assert((pix_width + 1) / 2 == width && (pix_height + 1) / 2 == height);
+        pthread_once(&chroma_once, build_chroma_tables);
+
         /* make a uarray2 to hold all the quantized quant_comp_vid structs
          * after we unpack them
          */
-        UArray2_T quant_arr = 
-                           UArray2_new(word_arr->width, word_arr->height, 
+        UArray2_T quant_arr = UArray2_new(width, height, 
                                                sizeof(struct quant_comp_vid));
-        UArray2_map_row_major(word_arr, &apply_quant_unpack, quant_arr);
+        quant_arr_unpack(word_arr, quant_arr);
 
 
         /*turn the quant_comp_vid array into a float_comp_vid array */
-        UArray2_T float_arr = UArray2_new(word_arr->width, word_arr->height,
+        UArray2_T float_arr = UArray2_new(width, height,
                                           sizeof(struct float_comp_vid));
-        UArray2_map_row_major(quant_arr, &apply_quant_to_float, float_arr);
-
+        for (int j = 0; j < height; j++) {
+                struct quant_comp_vid *qcv = UArray2_row_ptr(quant_arr, j);
+                struct float_comp_vid *fcv = UArray2_row_ptr(float_arr, j);
+                for (int i = 0; i < width; i++) {
+                        fcv[i] = quant_to_float(qcv[i]);
+                }
+        }
 
         UArray2_free(&quant_arr);
 
 
         /*turn the float comp vid array into a pixelwise comp_vid array */
-        UArray2b_T cv_array = UArray2b_new(float_arr->width * 2, 
-                                           float_arr->height * 2, 
+        UArray2b_T cv_array = UArray2b_new(pix_width, pix_height, 
                                            sizeof(struct comp_vid), BLK_SIZE);
-        UArray2_map_row_major(float_arr, &apply_float_to_block, 
-                                                           cv_array->blocks);
+        for (int j = 0; j < height; j++) {
+                struct float_comp_vid *fcv = UArray2_row_ptr(float_arr, j);
+                struct comp_vid *block = width == 0 ? NULL 
+                                           : UArray2b_block(cv_array, 0, j);
+                for (int i = 0; i < width; i++, block += BLOCK_LEN) {
+                        float_to_block(fcv[i], block);
+                }
+        }
 
         UArray2_free(&float_arr);
 
@@ -171,268 +340,994 @@ UArray2b_T word_to_comp_vid(UArray2_T word_arr)
 }
 
 
+/* Description: Fused compression kernel. Converts a 2x2 block of RGB pixels
+ *              straight to its 32-bit word, doing the component video 
+ *              conversion, cosine transform, quantization and packing on 
+ *              locals instead of going through the tiered arrays. Produces
+ *              the same word as rgb_to_comp_vid followed by comp_vid_to_word.
+ *              
+ * Input:       The four pixels of the block (top left, top right, bottom 
+ *              left, bottom right) and the denominator of their pixmap.
+ * Output:      32 bit word representing the block.
+ */
+uint32_t rgb_block_to_word(struct Pnm_rgb tl, struct Pnm_rgb tr, 
+                           struct Pnm_rgb bl, struct Pnm_rgb br, int denom)
+{
+        pthread_once(&chroma_once, build_chroma_tables);
+        return block_to_word(tl, tr, bl, br, rgb_pix_scale(denom));
+}
 
 
+/* Description: Runs the fused compression kernel across a pair of scanlines,
+ *              making one row of words.
+ *              
+ * Input:       Top and bottom scanlines of at least 2 * width pixels, the 
+ *              number of words to make, the denominator of the pixmap, and 
+ *              an array of width words to fill in.
+ * Output:      None. Words are written to the array.
+ */
+void rgb_rows_to_words(const struct Pnm_rgb *top, 
+                       const struct Pnm_rgb *bottom, int width, int denom, 
+                                                              uint32_t *words)
+{
+        int i = 0;
+        pthread_once(&chroma_once, build_chroma_tables);
 
+        /* the vector kernels do SIMD_LANES blocks at a time up to 
+         * packing, when the CPU has it, and the words are packed a chunk at
+         * a time; the rest go one by one 
+         */
+        if (simd_available()) {
+                struct float_comp_vid_lanes lanes;
+                struct quant_cols cols;
+                while (i + SIMD_LANES <= width) {
+                        int n = 0;
+                        for (; n < PACK_CHUNK && i + n + SIMD_LANES <= width;
+                                                            n += SIMD_LANES) {
+                                int32_t *quant[] = { 
+                                        cols.a + n, cols.b + n, cols.c + n, 
+                                        cols.d + n, cols.qpb + n, cols.qpr + n
+                                };
+                                simd_rgb_blocks_to_float(top + 2 * (i + n), 
+                                                         bottom + 2 * (i + n),
+                                                         denom, &lanes);
+                                simd_quantize_blocks(&lanes, chroma_bound, 
+                                                     CHROMA_LEVELS, quant);
+                        }
+                        pack_cols(&cols, n, words + i);
+                        i += n;
+                }
+        }
 
-/* Description: Apply function that maps through a Uarray2 of UArrays, each
- *              Uarray reprsenting a 2x2 block of CV pixels. Turns all the 
- *              blocks into float_comp_vids, which hold average values about 
- *              the entire block for simplification. 
+        double scale = rgb_pix_scale(denom);
+        for (; i < width; i++) {
+                words[i] = block_to_word(top[2 * i], top[2 * i + 1], 
+                                         bottom[2 * i], bottom[2 * i + 1], 
+                                                                       scale);
+        }
+}
+
+
+/* Description: Fused decompression kernel. Converts a 32-bit word straight 
+ *              to its 2x2 block of RGB pixels, doing the unpacking, 
+ *              dequantization, inverse cosine transform and RGB conversion 
+ *              on locals. Produces the same pixels as word_to_comp_vid 
+ *              followed by comp_vid_to_rgb.
  *              
- * Input:       Takes i and j indices of the block, pointer to the block 
- *              itself, new target array passed as closure where we'll place
- *              float_comp_vid structs. 
- * Output:      UArray2 of block average structs as closure. 
+ * Input:       32 bit word, and pointers to where the four pixels of the 
+ *              block (top left, top right, bottom left, bottom right) go.
+ * Output:      None. Pixels are written through the pointers. 
  */
-void apply_block_to_float(int i, int j, UArray2b_T cv_array, void *felem, 
-                                                            void *arr_closure)
+void word_to_rgb_block(uint32_t word, struct Pnm_rgb *tl, struct Pnm_rgb *tr,
+                                      struct Pnm_rgb *bl, struct Pnm_rgb *br)
 {
-        (void)cv_array;
+        pthread_once(&chroma_once, build_chroma_tables);
+        word_to_pixels(word, false, tl, tr, bl, br);
+}
 
-        UArray2_T float_array = arr_closure;
-        UArray_T block = *(UArray_T *)felem;
-        struct comp_vid *cvpixel;
-        struct float_comp_vid *fcv = UArray2_at(float_array, i, j);
-        float total_pr = 0;
-        float total_pb = 0;
 
-        assert(block != NULL);
+/* Description: The fused decompression kernel of word_to_rgb_block, to 
+ *              pixels with denominator RGB_DENOM or, if wide, RGB16_DENOM.
+ *              The chroma tables must already be built.
+ *              
+ * Input:       32 bit word, whether the pixels are wide, and pointers to 
+ *              where the four pixels of the block go.
+ * Output:      None. Pixels are written through the pointers. 
+ */
+static inline void word_to_pixels(uint32_t word, bool wide, 
+                                  struct Pnm_rgb *tl, struct Pnm_rgb *tr,
+                                  struct Pnm_rgb *bl, struct Pnm_rgb *br)
+{
+        /* same cell order as a block of a UArray2b with blocksize 2 */
+        struct comp_vid block[4];
+        struct quant_comp_vid qcv = quant_unpack(word);
+        float_to_block(quant_to_float(qcv), block);
+
+        /* the block's pixels all have the chroma of its levels */
+        int denom = wide ? RGB16_DENOM : RGB_DENOM;
+        struct chroma_terms pb = wide ? pb16_terms_of_level[qcv.qpb]
+                                      : pb_terms_of_level[qcv.qpb];
+        struct chroma_terms pr = wide ? pr16_terms_of_level[qcv.qpr]
+                                      : pr_terms_of_level[qcv.qpr];
+        *tl = lum_to_rgb(block[0].lum, pb, pr, denom);
+        *bl = lum_to_rgb(block[1].lum, pb, pr, denom);
+        *tr = lum_to_rgb(block[2].lum, pb, pr, denom);
+        *br = lum_to_rgb(block[3].lum, pb, pr, denom);
+}
+
+
+/* Description: Checks that n words can be decompressed: that neither chroma
+ *              index of any of them is past the levels the words keep. 
+ *              Decompressing a word that isn't is a CRE, which on a 
+ *              thread of a pool can't be caught, so anything decompressing
+ *              words it was given on a pool checks them first with this.
+ *              
+ * Input:       Array of n words.
+ * Output:      Whether every word is valid.
+ */
+bool words_valid(const uint32_t *words, size_t n)
+{
+        /* CHROMA_LEVELS is a power of two, so an index is past the levels 
+         * if and only if it has one of these bits set 
+         */
+        uint32_t past = (1u << PRPB_WIDTH) - CHROMA_LEVELS;
+        uint32_t invalid = past << LSB_PB | past << LSB_PR;
+        uint32_t any = 0;
+        for (size_t k = 0; k < n; k++) {
+                any |= words[k];
+        }
+        return (any & invalid) == 0;
+}
+
+
+/* Description: Runs the fused decompression kernel across a row of words,
+ *              making the pair of scanlines of RGB bytes it covers.
+ *              
+ * Input:       Row of width words, and two scanline buffers that each hold 
+ *              3 bytes for each of the row's 2 * width pixels.
+ * Output:      None. The scanlines are written to the buffers. 
+ */
+void words_to_rgb_rows(const uint32_t *words, int width, unsigned char *top,
+                                                        unsigned char *bottom)
+{
+        words_to_rows(words, width, top, bottom, false);
+}
+
+
+/* Description: words_to_rgb_rows to 16-bit samples: makes the pair of 
+ *              scanlines of a P6 with maxval RGB16_DENOM, each sample two 
+ *              bytes, most significant first. 
+ *              
+ * Input:       Row of width words, and two scanline buffers that each hold 
+ *              6 bytes for each of the row's 2 * width pixels.
+ * Output:      None. The scanlines are written to the buffers. 
+ */
+void words_to_rgb16_rows(const uint32_t *words, int width, 
+                         unsigned char *top, unsigned char *bottom)
+{
+        words_to_rows(words, width, top, bottom, true);
+}
+
 
-        struct comp_vid *cv1 = UArray_at(block, 0);
-        struct comp_vid *cv2 = UArray_at(block, 1);
-        struct comp_vid *cv3 = UArray_at(block, 2);
-        struct comp_vid *cv4 = UArray_at(block, 3);
+/* the fused decompression kernel across a row of words, to 3 bytes a pixel,
+ * or to 6 if wide
+ */
+static void words_to_rows(const uint32_t *words, int width, 
+                          unsigned char *top, unsigned char *bottom, 
+                          bool wide)
+{
+        int i = 0;
+        int pixel_bytes = wide ? 6 : 3;
+        pthread_once(&chroma_once, build_chroma_tables);
+
+        /* words are unpacked a chunk at a time, and the vector kernel does
+         * SIMD_LANES blocks at a time from the dequantized values on, when
+         * the CPU has it; the rest go one by one
+         */
+        if (simd_available()) {
+                struct float_comp_vid_lanes lanes;
+                struct quant_cols cols;
+                while (i + SIMD_LANES <= width) {
+                        int n = (width - i) / SIMD_LANES * SIMD_LANES;
+                        if (n > PACK_CHUNK) {
+                                n = PACK_CHUNK;
+                        }
+                        unpack_cols(words + i, n, &cols);
+
+                        for (int l = 0; l < n; l += SIMD_LANES) {
+                                for (int k = 0; k < SIMD_LANES; k++) {
+                                        struct float_comp_vid fcv = 
+                                           quant_to_float(get_quant(&cols, 
+                                                                    l + k));
+                                        lanes.a[k] = fcv.a;
+                                        lanes.b[k] = fcv.b;
+                                        lanes.c[k] = fcv.c;
+                                        lanes.d[k] = fcv.d;
+                                        lanes.pb_avg[k] = fcv.pb_avg;
+                                        lanes.pr_avg[k] = fcv.pr_avg;
+                                }
+                                int at = 2 * pixel_bytes * (i + l);
+                                if (wide) {
+                                        simd_float_to_rgb16_blocks(&lanes, 
+                                                                   top + at,
+                                                                bottom + at);
+                                } else {
+                                        simd_float_to_rgb_blocks(&lanes, 
+                                                                 top + at,
+                                                                 bottom + at);
+                                }
+                        }
+                        i += n;
+                }
+        }
+
+        struct Pnm_rgb tl, tr, bl, br;
+        for (; i < width; i++) {
+                word_to_pixels(words[i], wide, &tl, &tr, &bl, &br);
+
+                if (wide) {
+                        put_rgb16(top, 2 * i, tl);
+                        put_rgb16(top, 2 * i + 1, tr);
+                        put_rgb16(bottom, 2 * i, bl);
+                        put_rgb16(bottom, 2 * i + 1, br);
+                } else {
+                        put_rgb(top, 2 * i, tl);
+                        put_rgb(top, 2 * i + 1, tr);
+                        put_rgb(bottom, 2 * i, bl);
+                        put_rgb(bottom, 2 * i + 1, br);
+                }
+        }
+}
+
+
+/* stores a clipped RGB pixel as the three bytes of column i of a scanline */
+static inline void put_rgb(unsigned char *scanline, int i, struct Pnm_rgb pix)
+{
+        scanline[3 * i]     = pix.red;
+        scanline[3 * i + 1] = pix.green;
+        scanline[3 * i + 2] = pix.blue;
+}
+
+
+/* stores a clipped RGB pixel as the six bytes of column i of a scanline of 
+ * 16-bit samples, most significant byte first 
+ */
+static inline void put_rgb16(unsigned char *scanline, int i, 
+                             struct Pnm_rgb pix)
+{
+        unsigned char *at = scanline + 6 * i;
+        at[0] = pix.red >> 8;
+        at[1] = pix.red & 0xff;
+        at[2] = pix.green >> 8;
+        at[3] = pix.green & 0xff;
+        at[4] = pix.blue >> 8;
+        at[5] = pix.blue & 0xff;
+}
+
+
+/* ========================== FIXED-POINT KERNELS ========================= */
+
+/* These are plain scalar loops, a block at a time, with no SIMD path: they 
+ * are there to make the same words and pixels everywhere, not to be fast. 
+ */
+
+/* Description: Fixed-point version of rgb_rows_to_words. Each quantized 
+ *              value is worked out exactly, in integers, from the same 
+ *              decimal coefficients the float kernel uses, then rounded the 
+ *              way the float kernel rounds (a floored, b, c and d truncated,
+ *              chroma to the level whose bounds it is at or above). Where 
+ *              the float kernel's rounding error carries a value across one
+ *              of those steps the words differ, by one step of that value; 
+ *              otherwise they are the same. The words do not depend on the
+ *              compiler or the CPU. 
+ *              
+ * Input:       Top and bottom scanlines of at least 2 * width pixels, the 
+ *              number of words to make, the denominator of the pixmap (up to
+ *              65535), and an array of width words to fill in.
+ * Output:      None. Words are written to the array.
+ */
+void rgb_rows_to_words_fixed(const struct Pnm_rgb *top, 
+                       const struct Pnm_rgb *bottom, int width, int denom, 
+                                                              uint32_t *words)
+{
+        assert(denom > 0 && denom <= 65535);
+        pthread_once(&chroma_once, build_chroma_tables);
+
+        const int64_t *bounds = fix_chroma_bounds(denom);
+
+        /* 64 times a quarter of a sum of four lumas in thousandths of denom
+         * is twice the sum over scale 
+         */
+        int32_t scale = 125 * denom;
+        for (int i = 0; i < width; i++) {
+                words[i] = fix_block_to_word(top[2 * i], top[2 * i + 1], 
+                                             bottom[2 * i], bottom[2 * i + 1],
+                                                              scale, bounds);
+        }
+}
+
+
+/* Description: Fixed-point version of words_to_rgb_rows. Each sample is 
+ *              worked out exactly, in integers, from the word's values with
+ *              the decimal coefficients the float kernel uses, and truncated
+ *              and clipped as it does, so the pixels are within one of the 
+ *              float kernel's and do not depend on the compiler or the CPU.
+ *              
+ * Input:       Row of width words, and two scanline buffers that each hold 
+ *              3 bytes for each of the row's 2 * width pixels.
+ * Output:      None. The scanlines are written to the buffers. 
+ */
+void words_to_rgb_rows_fixed(const uint32_t *words, int width, 
+                             unsigned char *top, unsigned char *bottom)
+{
+        pthread_once(&chroma_once, build_chroma_tables);
+
+        for (int i = 0; i < width; i++) {
+                fix_word_to_rgb_block(words[i], i, top, bottom, false);
+        }
+}
+
+
+/* Description: Fixed-point version of words_to_rgb16_rows, worked out the 
+ *              same way as words_to_rgb_rows_fixed to denominator 
+ *              RGB16_DENOM.
+ *              
+ * Input:       Row of width words, and two scanline buffers that each hold 
+ *              6 bytes for each of the row's 2 * width pixels.
+ * Output:      None. The scanlines are written to the buffers. 
+ */
+void words_to_rgb16_rows_fixed(const uint32_t *words, int width, 
+                               unsigned char *top, unsigned char *bottom)
+{
+        pthread_once(&chroma_once, build_chroma_tables);
+
+        for (int i = 0; i < width; i++) {
+                fix_word_to_rgb_block(words[i], i, top, bottom, true);
+        }
+}
+
+
+/* Description: Gets, for a denominator, the smallest sum of four pixels' 
+ *              Pb (or Pr) in millionths that quantizes to each chroma 
+ *              level. They are worked out exactly, in integers, from the 
+ *              exact form of the chroma bounds, the first time a thread 
+ *              asks for a denominator, and kept until it asks for another.
+ *              Needs the chroma tables to be built. 
+ *              
+ * Input:       Denominator, up to 65535.
+ * Output:      The CHROMA_LEVELS bounds, which are the thread's own. 
+ */
+static const int64_t *fix_chroma_bounds(int denom)
+{
+        pthread_once(&fix_bounds_once, make_fix_bounds_key);
+        struct fix_bounds *bounds = pthread_getspecific(fix_bounds_key);
+        if (bounds == NULL) {
+                bounds = malloc(sizeof(*bounds));
+                assert(bounds != NULL);
+                bounds->denom = 0;
+                int rc = pthread_setspecific(fix_bounds_key, bounds);
+                assert(rc == 0);
+        }
+
+        /* a numerator is below 2^46, so times the denominator it is still
+         * within 64 bits 
+         */
+        if (bounds->denom != denom) {
+                for (int q = 0; q < CHROMA_LEVELS; q++) {
+                        bounds->bound[q] = fix_ceil_shift(fix_bound_num[q] 
+                                                          * denom, 
+                                                    fix_bound_shift[q]);
+                }
+                bounds->denom = denom;
+        }
+        return bounds->bound;
+}
+
+
+/* makes the key of each thread's bounds, which are freed with the thread */
+static void make_fix_bounds_key(void)
+{
+        int rc = pthread_key_create(&fix_bounds_key, free);
+        assert(rc == 0);
+}
+
+
+/* n over 2^shift, rounded up */
+static inline int64_t fix_ceil_shift(int64_t n, int shift)
+{
+        if (shift >= 63) {
+                return n > 0;
+        }
+        int64_t d = (int64_t)1 << shift;
+        return n / d + (n % d > 0);
+}
 
-        assert(cv1 != NULL && cv2 != NULL && cv3 != NULL && cv4 != NULL);
 
-        float y1 = cv1->lum;
-        float y2 = cv2->lum;
-        float y3 = cv3->lum;
-        float y4 = cv4->lum;
+/* Description: Converts a 2x2 block of RGB pixels to its word in integers.
+ *              
+ * Input:       The four pixels of the block (top left, top right, bottom 
+ *              left, bottom right), 125 times the denominator, and the 
+ *              chroma bounds for the denominator.
+ * Output:      32 bit word representing the block.
+ */
+static inline uint32_t fix_block_to_word(struct Pnm_rgb tl, 
+                         struct Pnm_rgb tr, struct Pnm_rgb bl, 
+                         struct Pnm_rgb br, int32_t scale, 
+                         const int64_t bounds[])
+{
+        struct quant_comp_vid qcv;
+
+        /* same order as the cells of a block, as in block_to_float */
+        int32_t y1 = fix_luma(tl);
+        int32_t y2 = fix_luma(bl);
+        int32_t y3 = fix_luma(tr);
+        int32_t y4 = fix_luma(br);
+
+        int64_t pb = FIX_PB_R * ((int64_t)tl.red + tr.red + bl.red + br.red)
+               + FIX_PB_G * ((int64_t)tl.green + tr.green + bl.green + br.green)
+               + FIX_PB_B * ((int64_t)tl.blue + tr.blue + bl.blue + br.blue);
+        int64_t pr = FIX_PR_R * ((int64_t)tl.red + tr.red + bl.red + br.red)
+               + FIX_PR_G * ((int64_t)tl.green + tr.green + bl.green + br.green)
+               + FIX_PR_B * ((int64_t)tl.blue + tr.blue + bl.blue + br.blue);
+
+        /* a goes into its 6 bits the same way the float kernel's does */
+        qcv.a   = 2 * (y1 + y2 + y3 + y4) / scale;
+        qcv.b   = fix_coef(y4 + y3 - y2 - y1, scale);
+        qcv.c   = fix_coef(y4 - y3 + y2 - y1, scale);
+        qcv.d   = fix_coef(y4 - y3 - y2 + y1, scale);
+        qcv.qpb = fix_chroma_level(pb, bounds);
+        qcv.qpr = fix_chroma_level(pr, bounds);
+
+        return quant_pack(qcv);
+}
+
+
+/* luma of a pixel in thousandths of the pixmap's denominator */
+static inline int32_t fix_luma(struct Pnm_rgb pix)
+{
+        return FIX_Y_R * (int32_t)pix.red + FIX_Y_G * (int32_t)pix.green 
+                                          + FIX_Y_B * (int32_t)pix.blue;
+}
+
+
+/* quantizes one of b, c and d from the sum of lumas it is a quarter of, 
+ * truncating like the float kernel, and clips it; clipping to 0.3 first 
+ * would change nothing
+ */
+static inline int32_t fix_coef(int32_t sum, int32_t scale)
+{
+        int32_t q = 2 * sum / scale;
+        if (q > QCVB_HIGH) {
+                q = QCVB_HIGH;
+        } else if (q < QCVB_LOW) {
+                q = QCVB_LOW;
+        }
+        return q;
+}
+
+
+/* the chroma level of a sum of four chromas in millionths */
+static inline unsigned fix_chroma_level(int64_t sum, const int64_t bounds[])
+{
+        unsigned level = 0;
+        for (int q = 1; q < CHROMA_LEVELS; q++) {
+                level += sum >= bounds[q];
+        }
+        return level;
+}
+
+
+/* Description: Converts a word to its 2x2 block of RGB pixels in integers.
+ *              
+ * Input:       32 bit word, its column i in the row of words, the top and 
+ *              bottom scanlines its pixels go in, and whether they take 6 
+ *              bytes a pixel instead of 3.
+ * Output:      None. The pixels are written. 
+ */
+static inline void fix_word_to_rgb_block(uint32_t word, int i, 
+                                         unsigned char *top,
+                                         unsigned char *bottom, bool wide)
+{
+        struct quant_comp_vid qcv = quant_unpack(word);
+        assert(qcv.qpb < CHROMA_LEVELS && qcv.qpr < CHROMA_LEVELS);
+
+        int32_t a = FIX_A_UNIT * qcv.a;
+        int32_t b = fix_dequant_coef(qcv.b);
+        int32_t c = fix_dequant_coef(qcv.c);
+        int32_t d = fix_dequant_coef(qcv.d);
+
+        int64_t red   = fix_red_of_pr[qcv.qpr];
+        int64_t green = fix_green_of_pb[qcv.qpb] + fix_green_of_pr[qcv.qpr];
+        int64_t blue  = fix_blue_of_pb[qcv.qpb];
+
+        /* the inverse cosine transform of float_to_block */
+        fix_put_pixel(top,    2 * i,     a - b - c + d, red, green, blue, wide);
+        fix_put_pixel(bottom, 2 * i,     a - b + c - d, red, green, blue, wide);
+        fix_put_pixel(top,    2 * i + 1, a + b - c - d, red, green, blue, wide);
+        fix_put_pixel(bottom, 2 * i + 1, a + b + c + d, red, green, blue, wide);
+}
+
+
+/* dequantizes one of b, c and d to units of luma, clipped to 0.3 */
+static inline int32_t fix_dequant_coef(int32_t q)
+{
+        int32_t coef = FIX_BCD_UNIT * q;
+        if (coef > FIX_BCD_BOUND) {
+                coef = FIX_BCD_BOUND;
+        } else if (coef < -FIX_BCD_BOUND) {
+                coef = -FIX_BCD_BOUND;
+        }
+        return coef;
+}
+
+
+/* writes column i of a scanline from the pixel's luma, clipped, and the 
+ * parts of each sample its chroma makes 
+ */
+static inline void fix_put_pixel(unsigned char *scanline, int i, int32_t lum,
+                                 int64_t red, int64_t green, int64_t blue, 
+                                 bool wide)
+{
+        if (lum > FIX_LUM_UNITS) {
+                lum = FIX_LUM_UNITS;
+        } else if (lum < 0) {
+                lum = 0;
+        }
+
+        struct Pnm_rgb pix;
+        int denom = wide ? RGB16_DENOM : RGB_DENOM;
+        int64_t base = lum * FIX_LUM_SCALE;
+        pix.red   = fix_sample(base + red, denom);
+        pix.green = fix_sample(base + green, denom);
+        pix.blue  = fix_sample(base + blue, denom);
+
+        if (wide) {
+                put_rgb16(scanline, i, pix);
+        } else {
+                put_rgb(scanline, i, pix);
+        }
+}
+
+
+/* a sample over denom from its numerator over FIX_DEN, truncated and 
+ * clipped; the numerator is below 2^50, so with FIX_DEN_FACTOR cancelled 
+ * it times RGB16_DENOM fits
+ */
+static inline unsigned fix_sample(int64_t numerator, int denom)
+{
+        if (numerator <= 0) {
+                return 0;
+        }
+        uint64_t sample = (uint64_t)numerator * (denom / FIX_DEN_FACTOR) 
+                                              / (FIX_DEN / FIX_DEN_FACTOR);
+        return sample > (uint64_t)denom ? (unsigned)denom : sample;
+}
+
+
+
+/* Description: The fused compression kernel of rgb_block_to_word, for a 
+ *              scale that rgb_pix_scale has already worked out. 
+ *              
+ * Input:       The four pixels of the block (top left, top right, bottom 
+ *              left, bottom right) and the scale of their pixmap.
+ * Output:      32 bit word representing the block.
+ */
+static inline uint32_t block_to_word(struct Pnm_rgb tl, struct Pnm_rgb tr, 
+                        struct Pnm_rgb bl, struct Pnm_rgb br, double scale)
+{
+        /* same cell order as a block of a UArray2b with blocksize 2 */
+        struct comp_vid block[4];
+        block[0] = rgb_pix_to_cv(tl, scale);
+        block[1] = rgb_pix_to_cv(bl, scale);
+        block[2] = rgb_pix_to_cv(tr, scale);
+        block[3] = rgb_pix_to_cv(br, scale);
+
+        return quant_pack(float_to_quant(block_to_float(block)));
+}
+
+
+/* Description: Averages a 2x2 block of CV pixels into a float_comp_vid.
+ *              
+ * Input:       Array of the four CV pixels, in UArray2b block cell order.
+ * Output:      Clipped float_comp_vid for the block. 
+ */
+static inline struct float_comp_vid block_to_float(struct comp_vid cv[])
+{
+        struct float_comp_vid fcv;
+        float total_pr = 0;
+        float total_pb = 0;
+
+        float y1 = cv[0].lum;
+        float y2 = cv[1].lum;
+        float y3 = cv[2].lum;
+        float y4 = cv[3].lum;
         
         for (int k = 0; k < BLOCK_LEN; k++) {
-            cvpixel = UArray_at(block, k);
-            total_pb  += cvpixel->pb;
-            total_pr  += cvpixel->pr;
+            total_pb  += cv[k].pb;
+            total_pr  += cv[k].pr;
         }
 
         //some calculations to average the values of the pixels.
         //avg brightness, left to right brightness, top to bottom, diagonal. 
-        fcv->a      = (y1 + y2 + y3 + y4) / BLOCK_LEN;
-        fcv->b      = (y4 + y3 - y2 - y1) / BLOCK_LEN;
-        fcv->c      = (y4 - y3 + y2 - y1) / BLOCK_LEN;
-        fcv->d      = (y4 - y3 - y2 + y1) / BLOCK_LEN; 
+        fcv.a      = (y1 + y2 + y3 + y4) / BLOCK_LEN;
+        fcv.b      = (y4 + y3 - y2 - y1) / BLOCK_LEN;
+        fcv.c      = (y4 - y3 + y2 - y1) / BLOCK_LEN;
+        fcv.d      = (y4 - y3 - y2 + y1) / BLOCK_LEN; 
 
         //average color values
-        fcv->pb_avg = total_pb / BLOCK_LEN;
-        fcv->pr_avg = total_pr / BLOCK_LEN;
+        fcv.pb_avg = total_pb / BLOCK_LEN;
+        fcv.pr_avg = total_pr / BLOCK_LEN;
+
+        clip_float_cv(&fcv);
+        return fcv;
+}
 
-        clip_float_cv(fcv);
 
-        struct float_comp_vid *elem = UArray2_at(float_array, i, j);
-        elem->a = fcv->a;
-        elem->b = fcv->b;
-        elem->c = fcv->c;
-        elem->d = fcv->d;
-        elem->pb_avg = fcv->pb_avg;
-        elem->pr_avg = fcv->pr_avg;
+
+
+/* Description: Turns the averages of one block back into its 2x2 block of CV
+ *              pixels. 
+ *              
+ * Input:       float_comp_vid of a block, and an array of four CV pixels to 
+ *              fill in, in UArray2b block cell order.
+ * Output:      None. Clipped CV pixels are written to the array.
+ */
+static inline void float_to_block(struct float_comp_vid fcv, 
+                                                         struct comp_vid cv[])
+{
+        clip_float_cv(&fcv);
+
+        float a = fcv.a;
+        float b = fcv.b;
+        float c = fcv.c;
+        float d = fcv.d;
+
+        /*calculating the cosine transformed luminance values */
+        cv[0].lum = (a - b - c + d);
+        cv[1].lum = (a - b + c - d);
+        cv[2].lum = (a + b - c - d);
+        cv[3].lum = (a + b + c + d);
+
+        for (int k = 0; k < BLOCK_LEN; k++) {
+                cv[k].pb = fcv.pb_avg;
+                cv[k].pr = fcv.pr_avg;
+                clip_cv(&cv[k]);
+        }
 }
 
 
+/* Description: Quantizes the averages of one block. 
+ *              
+ * Input:       float_comp_vid of a block.
+ * Output:      Clipped quant_comp_vid of the block. 
+ */
+static inline struct quant_comp_vid float_to_quant(struct float_comp_vid fcv)
+{
+        struct quant_comp_vid qcv = luma_to_quant(fcv);
+
+        qcv.qpb = chroma_to_level(fcv.pb_avg);
+        qcv.qpr = chroma_to_level(fcv.pr_avg);
+
+        return qcv;
+}
 
 
-/* Description: Apply function that maps through a Uarray2 of float comp vids,
- *              each of which represents a 2x2 block of pixels. Turns all the 
- *              averages to 2x2 blocks of CV pixels. 
+/* Description: Quantizes the cosine coefficients of one block, leaving its 
+ *              chroma levels 0. 
  *              
- * Input:       Takes i and j indices of the block, pointer to the block 
- *              itself, new target array passed as closure where we'll place
- *              float_comp_vid structs. 
- * Output:      UArray2b of CV pixels as closure. 
+ * Input:       float_comp_vid of a block.
+ * Output:      Clipped quant_comp_vid of the block. 
  */
-void apply_float_to_block(int i, int j, UArray2_T float_array, void *elem, 
-                                                               void *arr2b_cl)
+static inline struct quant_comp_vid luma_to_quant(struct float_comp_vid fcv)
 {
-        struct float_comp_vid *fcv = UArray2_at(float_array, i, j);
-        UArray2_T blocks = arr2b_cl;
-        assert(blocks != NULL);
-        assert(fcv != NULL);
-        (void)elem;
+        struct quant_comp_vid qcv;
 
-        clip_float_cv(fcv);
+        qcv.qpb = 0;
+        qcv.qpr = 0;
+        qcv.a   = (fcv.a * QUANT_FACTOR);
+        qcv.b   = (fcv.b * QUANT_FACTOR);
+        qcv.c   = (fcv.c * QUANT_FACTOR);
+        qcv.d   = (fcv.d * QUANT_FACTOR);
 
-        float a = fcv->a;
-        float b = fcv->b;
-        float c = fcv->c;
-        float d = fcv->d;
+        clip_quant(&qcv);
+        return qcv;
+}
 
-        /*calculating the cosine transformed luminance values */
-        float lum1 = (a - b - c + d);
-        float lum2 = (a - b + c - d);
-        float lum3 = (a + b - c - d);
-        float lum4 = (a + b + c + d);
-
-        UArray_T block = *(UArray_T*)UArray2_at(blocks, i, j);
-
-        //get each pixel from the UArray
-        struct comp_vid *pix1 = UArray_at(block, 0);
-        struct comp_vid *pix2 = UArray_at(block, 1);
-        struct comp_vid *pix3 = UArray_at(block, 2);
-        struct comp_vid *pix4 = UArray_at(block, 3);
-
-        pix1->lum = lum1;
-        pix1->pb = fcv->pb_avg;
-        pix1->pr = fcv->pr_avg;
-        clip_cv(pix1);
-
-        pix2->lum = lum2;
-        pix2->pb = fcv->pb_avg;
-        pix2->pr = fcv->pr_avg;
-        clip_cv(pix2);
-        
-        pix3->lum = lum3;
-        pix3->pb = fcv->pb_avg;
-        pix3->pr = fcv->pr_avg;
-        clip_cv(pix3);
 
-        pix4->lum = lum4;
-        pix4->pb = fcv->pb_avg;
-        pix4->pr = fcv->pr_avg;
-        clip_cv(pix4);
+/* Description: Quantizes an average chroma to its level, the index arith40 
+ *              gives it halved, by counting the level bounds at or below 
+ *              it. Needs the chroma tables to be built. 
+ *              
+ * Input:       Clipped average chroma.
+ * Output:      Its level, below CHROMA_LEVELS.
+ */
+static inline unsigned chroma_to_level(float x)
+{
+        unsigned level = 0;
+        for (int q = 1; q < CHROMA_LEVELS; q++) {
+                level += x >= chroma_bound[q];
+        }
+        return level;
 }
 
 
-/* Description: Apply function that maps through a Uarray2 of float comp vids,
- *              each of which represents a 2x2 block of pixels. Quantizes all 
- *              values using a struct that holds bit fields. Uses arith
- *              functions to perform nonlinear quantization. 
+/* Description: Builds the chroma tables from arith40: the chroma each level
+ *              dequantizes to, and the smallest chroma that quantizes to 
+ *              each level, found by bisecting between the clip bounds, so 
+ *              that looking a chroma up gives exactly the level arith40 
+ *              would. Run once, with pthread_once. 
  *              
- * Input:       Takes i and j indices of the fcv, pointer to the fcv itself, 
- *              new target array passed as closure where we'll place
- *              quantized_comp_vid structs. 
- * Output:      UArray2 of QCVs as closure. 
+ * Input:       None.
+ * Output:      None. The tables are filled in. 
  */
-void apply_float_to_quant(int i, int j, UArray2_T float_array, void *elem, 
-                                                                     void *cl)
+static void build_chroma_tables(void)
 {
-        //converts float values to quantized values and stores them in 
-        //quantized structure. 
+        assert(arith_level_of_chroma(AV_LOW_BOUND) == 0);
+        assert(arith_level_of_chroma(AV_HIGH_BOUND) == CHROMA_LEVELS - 1);
+
+        for (int q = 0; q < CHROMA_LEVELS; q++) {
+                chroma_of_level[q] = Arith40_chroma_of_index(q * 2);
+                pb_terms_of_level[q] = pb_terms(chroma_of_level[q], 
+                                                RGB_DENOM);
+                pr_terms_of_level[q] = pr_terms(chroma_of_level[q], 
+                                                RGB_DENOM);
+                pb16_terms_of_level[q] = pb_terms(chroma_of_level[q], 
+                                                  RGB16_DENOM);
+                pr16_terms_of_level[q] = pr_terms(chroma_of_level[q], 
+                                                  RGB16_DENOM);
+
+                int64_t micro = llround(chroma_of_level[q] * 1e6);
+                fix_red_of_pr[q]   = FIX_R_PR * micro * FIX_CHROMA_SCALE;
+                fix_green_of_pb[q] = FIX_G_PB * micro * FIX_CHROMA_SCALE;
+                fix_green_of_pr[q] = FIX_G_PR * micro * FIX_CHROMA_SCALE;
+                fix_blue_of_pb[q]  = FIX_B_PB * micro * FIX_CHROMA_SCALE;
+        }
+
+        chroma_bound[0] = AV_LOW_BOUND;
+        for (unsigned q = 1; q < CHROMA_LEVELS; q++) {
+                /* lo is always below level q, hi always at or above it */
+                float lo = AV_LOW_BOUND;
+                float hi = AV_HIGH_BOUND;
+                for (;;) {
+                        float mid = lo / 2 + hi / 2;
+                        if (mid <= lo || mid >= hi) {
+                                mid = nextafterf(lo, hi);
+                        }
+                        if (mid >= hi) {
+                                break;
+                        }
+                        if (arith_level_of_chroma(mid) >= q) {
+                                hi = mid;
+                        } else {
+                                lo = mid;
+                        }
+                }
+                chroma_bound[q] = hi;
+        }
 
-        struct float_comp_vid *fcv = elem;
-        UArray2_T quant_arr = cl;
-        struct quant_comp_vid *qcv = UArray2_at(quant_arr, i, j);
+        /* a float is its 24-bit mantissa over a power of two, so this is 
+         * exact; 4 * 10^6 is for the sum of four chromas in millionths 
+         */
+        for (int q = 0; q < CHROMA_LEVELS; q++) {
+                int exp;
+                int64_t mant = (int64_t)ldexpf(frexpf(chroma_bound[q], &exp), 
+                                                                         24);
+                int shift = 24 - exp;
+                while (shift > 0 && mant % 2 == 0) {
+                        mant /= 2;
+                        shift--;
+                }
+                fix_bound_num[q] = mant * 4000000;
+                fix_bound_shift[q] = shift;
+        }
+}
 
-        unsigned b = Arith40_index_of_chroma(fcv->pb_avg);
-        unsigned r = Arith40_index_of_chroma(fcv->pr_avg);
-        qcv->qpb = b / 2;
-        qcv->qpr = r / 2;
-        qcv->a   = (fcv->a * QUANT_FACTOR);
-        qcv->b   = (fcv->b * QUANT_FACTOR);
-        qcv->c   = (fcv->c * QUANT_FACTOR);
-        qcv->d   = (fcv->d * QUANT_FACTOR);
 
-        clip_quant(qcv);
-        (void)float_array;
+/* the level of a chroma, straight from arith40 */
+static unsigned arith_level_of_chroma(float x)
+{
+        return Arith40_index_of_chroma(x) / 2;
 }
 
 
-/* Description: Apply function that maps through a Uarray2 of quantized 
- *              component video values and packs each quanitzed element into
- *              a 32 bit word as a client of the bitpack module. 
+/* Description: Packs a UArray2 of quantized comp video values into the
+ *              UArray2 of 32 bit words of the same size, going along each 
+ *              row a chunk of blocks at a time with the batch functions of 
+ *              the bitpack module.
  *              
- * Input:       Takes i and j indices of the QCV, pointer to the QCV itself, 
- *              new target array passed as closure where we'll place
- *              words. 
- * Output:      UArray2 of 32 bit words as closure. 
+ * Input:       UArray2 of QCVs, and the UArray2 of words to fill in.
+ * Output:      None. Words are written to the word array.
  */
-void apply_quant_pack(int i, int j, UArray2_T quant_arr, void *elem, 
-                                                                     void *cl)
+static void quant_arr_pack(UArray2_T quant_arr, UArray2_T word_arr)
 {
-        struct quant_comp_vid *qcv = elem;
+        struct quant_cols cols;
+        int width = quant_arr->width;
+        assert(word_arr->size == sizeof(uint32_t));
+
+        for (int j = 0; j < quant_arr->height; j++) {
+                struct quant_comp_vid *qcv = UArray2_row_ptr(quant_arr, j);
+                uint32_t *words = UArray2_row_ptr(word_arr, j);
+
+                for (int i = 0; i < width; i += PACK_CHUNK) {
+                        int n = width - i < PACK_CHUNK ? width - i : PACK_CHUNK;
+                        for (int k = 0; k < n; k++) {
+                                put_quant(&cols, k, qcv[i + k]);
+                        }
+                        pack_cols(&cols, n, words + i);
+                }
+        }
+}
 
-        UArray2_T word_array = cl;
-        uint32_t *word = UArray2_at(word_array, i, j);
 
-        //each element of the quantized struct has a location in the 32b word
-        *word = (uint32_t) Bitpack_newu(* (uint64_t *)word, ABCD_WIDTH, LSB_A, 
-                                                            (uint64_t)qcv->a);
-        *word = (uint32_t) Bitpack_news(* (uint64_t *)word, ABCD_WIDTH, LSB_B, 
-                                Bitpack_gets((int64_t)qcv->b, ABCD_WIDTH, 0));
-        *word = (uint32_t) Bitpack_news(* (uint64_t *)word, ABCD_WIDTH, LSB_C,
-                                Bitpack_gets((int64_t)qcv->c, ABCD_WIDTH, 0));
-        *word = (uint32_t) Bitpack_news(* (uint64_t *)word, ABCD_WIDTH, LSB_D, 
-                                Bitpack_gets((int64_t)qcv->d, ABCD_WIDTH, 0));
-        *word = (uint32_t) Bitpack_newu(*(uint64_t *)word, PRPB_WIDTH, LSB_PB, 
-                                                          (uint64_t)qcv->qpb);
-        *word = (uint32_t) Bitpack_newu(*(uint64_t *)word, PRPB_WIDTH, LSB_PR, 
-                                                          (uint64_t)qcv->qpr);
+/* Description: Packs the quantized values of one block into a 32 bit word as
+ *              a client of the bitpack module.
+ *              
+ * Input:       quant_comp_vid of a block.
+ * Output:      32 bit word. 
+ */
+static inline uint32_t quant_pack(struct quant_comp_vid qcv)
+{
+        uint64_t word = 0;
+
+        //each element of the quantized struct has a location in the 32b word;
+        //the layout is fixed, so the masks and shifts fold to constants
+        word = BITPACK_NEWU(word, ABCD_WIDTH, LSB_A, qcv.a);
+        word = BITPACK_NEWS(word, ABCD_WIDTH, LSB_B, 
+                                BITPACK_GETS(qcv.b, ABCD_WIDTH, 0));
+        word = BITPACK_NEWS(word, ABCD_WIDTH, LSB_C,
+                                BITPACK_GETS(qcv.c, ABCD_WIDTH, 0));
+        word = BITPACK_NEWS(word, ABCD_WIDTH, LSB_D, 
+                                BITPACK_GETS(qcv.d, ABCD_WIDTH, 0));
+        word = BITPACK_NEWU(word, PRPB_WIDTH, LSB_PB, qcv.qpb);
+        word = BITPACK_NEWU(word, PRPB_WIDTH, LSB_PR, qcv.qpr);
+
+        return (uint32_t)word;
+}
+
+
+/* Description: Unpacks a UArray2 of 32 bit words into the UArray2 of 
+ *              quantized comp video values of the same size, the reverse of
+ *              quant_arr_pack.
+ *              
+ * Input:       UArray2 of words, and the UArray2 of QCVs to fill in.
+ * Output:      None. QCVs are written to the quantized array.
+ */
+static void quant_arr_unpack(UArray2_T word_arr, UArray2_T quant_arr)
+{
+        struct quant_cols cols;
+        int width = word_arr->width;
+        assert(word_arr->size == sizeof(uint32_t));
+
+        for (int j = 0; j < word_arr->height; j++) {
+                uint32_t *words = UArray2_row_ptr(word_arr, j);
+                struct quant_comp_vid *qcv = UArray2_row_ptr(quant_arr, j);
+
+                for (int i = 0; i < width; i += PACK_CHUNK) {
+                        int n = width - i < PACK_CHUNK ? width - i : PACK_CHUNK;
+                        unpack_cols(words + i, n, &cols);
+                        for (int k = 0; k < n; k++) {
+                                qcv[i + k] = get_quant(&cols, k);
+                        }
+                }
+        }
+}
+
+
+/* stores the quantized values of a block as entry k of the columns */
+static inline void put_quant(struct quant_cols *cols, int k, 
+                                                    struct quant_comp_vid qcv)
+{
+        cols->a[k]   = qcv.a;
+        cols->b[k]   = qcv.b;
+        cols->c[k]   = qcv.c;
+        cols->d[k]   = qcv.d;
+        cols->qpb[k] = qcv.qpb;
+        cols->qpr[k] = qcv.qpr;
+}
+
+
+/* gets the quantized values of the block at entry k of the columns */
+static inline struct quant_comp_vid get_quant(const struct quant_cols *cols,
+                                                                        int k)
+{
+        struct quant_comp_vid qcv;
 
-        (void)quant_arr;
+        qcv.a   = cols->a[k];
+        qcv.b   = cols->b[k];
+        qcv.c   = cols->c[k];
+        qcv.d   = cols->d[k];
+        qcv.qpb = cols->qpb[k];
+        qcv.qpr = cols->qpr[k];
+
+        return qcv;
 }
 
 
-/* Description: Apply function that maps through a Uarray2 of 32 bit words 
- *              and pulls out the quantized component video values.
+/* Description: Packs the first n blocks of a set of columns into words with
+ *              the same layout as quant_pack.
  *              
- * Input:       Takes i and j indices of the word, pointer to the word itself,
- *              new target array passed as closure where we'll place
- *              QCVs. 
- * Output:      UArray2 of QCVs as closure. 
+ * Input:       Columns of quantized values, how many of them are used, and
+ *              an array of n words to fill in.
+ * Output:      None. Words are written to the array.
  */
-void apply_quant_unpack(int i, int j, UArray2_T word_array, void *elem, 
-                                                                     void *cl)
+static void pack_cols(const struct quant_cols *cols, int n, uint32_t *words)
 {
-        uint64_t *word = UArray2_at(word_array, i, j);
-        UArray2_T quant_arr = cl;
-        struct quant_comp_vid *qcv = UArray2_at(quant_arr, i , j);
+        struct Bitpack_field layout[] = {
+                { ABCD_WIDTH, LSB_A, false }, { ABCD_WIDTH, LSB_B, true },
+                { ABCD_WIDTH, LSB_C, true },  { ABCD_WIDTH, LSB_D, true },
+                { PRPB_WIDTH, LSB_PB, false }, { PRPB_WIDTH, LSB_PR, false }
+        };
+        const int32_t *const values[] = {
+                cols->a, cols->b, cols->c, cols->d, cols->qpb, cols->qpr
+        };
+
+        Bitpack_pack_words(words, n, layout, 6, values);
+}
 
-        //each element of the quantized struct has a location in the 32b word
-        qcv->a =  (uint32_t) Bitpack_getu(*(uint64_t*)word, ABCD_WIDTH, 
-                                                                    LSB_A);
-        qcv->b = (int32_t) Bitpack_gets(*(uint64_t *)word, ABCD_WIDTH, LSB_B);
-        qcv->c = (int32_t) Bitpack_gets(*(uint64_t *)word, ABCD_WIDTH, LSB_C);
-        qcv->d = (int32_t) Bitpack_gets(*(uint64_t *)word, ABCD_WIDTH, LSB_D);
-        qcv->qpb = (uint32_t) Bitpack_getu(*(uint64_t *)word, PRPB_WIDTH, 
-                                                                    LSB_PB);
-        qcv->qpr = (uint32_t) Bitpack_getu(*(uint64_t *)word, PRPB_WIDTH,
-                                                                    LSB_PR);
 
-        (void)elem;
+/* Description: Unpacks n words into a set of columns, the reverse of 
+ *              pack_cols.
+ *              
+ * Input:       Array of n words, and the columns to fill in.
+ * Output:      None. Quantized values are written to the columns.
+ */
+static void unpack_cols(const uint32_t *words, int n, struct quant_cols *cols)
+{
+        struct Bitpack_field layout[] = {
+                { ABCD_WIDTH, LSB_A, false }, { ABCD_WIDTH, LSB_B, true },
+                { ABCD_WIDTH, LSB_C, true },  { ABCD_WIDTH, LSB_D, true },
+                { PRPB_WIDTH, LSB_PB, false }, { PRPB_WIDTH, LSB_PR, false }
+        };
+        int32_t *const values[] = {
+                cols->a, cols->b, cols->c, cols->d, cols->qpb, cols->qpr
+        };
+
+        Bitpack_unpack_words(words, n, layout, 6, values);
+}
+
+
+/* Description: Pulls the quantized values of one block out of its 32 bit 
+ *              word as a client of the bitpack module.
+ *              
+ * Input:       32 bit word.
+ * Output:      quant_comp_vid of the block. 
+ */
+static inline struct quant_comp_vid quant_unpack(uint32_t word)
+{
+        struct quant_comp_vid qcv;
+
+        //each element of the quantized struct has a location in the 32b word
+        qcv.a =  (uint32_t) BITPACK_GETU(word, ABCD_WIDTH, LSB_A);
+        qcv.b = (int32_t) BITPACK_GETS(word, ABCD_WIDTH, LSB_B);
+        qcv.c = (int32_t) BITPACK_GETS(word, ABCD_WIDTH, LSB_C);
+        qcv.d = (int32_t) BITPACK_GETS(word, ABCD_WIDTH, LSB_D);
+        qcv.qpb = (uint32_t) BITPACK_GETU(word, PRPB_WIDTH, LSB_PB);
+        qcv.qpr = (uint32_t) BITPACK_GETU(word, PRPB_WIDTH, LSB_PR);
+
+        return qcv;
 }
 
 
-/* Description: Apply function that maps through a Uarray2 of quantized comp
- *              video values and unquantizes them, turning them back into 
- *              floats. 
+/* Description: Dequantizes the values of one block. 
  *              
- * Input:       Takes i and j indices of the QCV, pointer to the QCV itself, 
- *              new target array passed as closure where we'll place
- *              FCV. 
- * Output:      UArray2 of FCVs as closure. 
- */
-void apply_quant_to_float(int i, int j, UArray2_T quant_arr, void *elem, 
-                                                                     void *cl)
-{
-        //converts quant_comp_vid structs to float_comp_vid structs and stores
-        // them in the word_array
-        struct quant_comp_vid *qcv = elem;
-        UArray2_T float_arr = cl;
-
-        assert(qcv != NULL);
-        assert(float_arr != NULL);
-        struct float_comp_vid *fcv = UArray2_at(float_arr, i, j);
-        assert(fcv != NULL);
-
-        //deindex all quantized values
-        fcv->pb_avg = (float) Arith40_chroma_of_index(qcv->qpb * 2) ;
-        fcv->pr_avg = (float) Arith40_chroma_of_index(qcv->qpr * 2) ;
-        fcv->a   = (float)qcv->a / A_QUANT_FACTOR;
-        fcv->b   = (float)qcv->b / QUANT_FACTOR;
-        fcv->c   = (float)qcv->c / QUANT_FACTOR;
-        fcv->d   = (float)qcv->d / QUANT_FACTOR;
-
-        (void)quant_arr;
+ * Input:       quant_comp_vid of a block.
+ * Output:      float_comp_vid of the block. 
+ */
+static inline struct float_comp_vid quant_to_float(struct quant_comp_vid qcv)
+{
+        struct float_comp_vid fcv;
+
+        //deindex all quantized values; a chroma level past the table is a 
+        //corrupt word
+        assert(qcv.qpb < CHROMA_LEVELS && qcv.qpr < CHROMA_LEVELS);
+        fcv.pb_avg = chroma_of_level[qcv.qpb];
+        fcv.pr_avg = chroma_of_level[qcv.qpr];
+        fcv.a   = (float)qcv.a / A_QUANT_FACTOR;
+        fcv.b   = (float)qcv.b / QUANT_FACTOR;
+        fcv.c   = (float)qcv.c / QUANT_FACTOR;
+        fcv.d   = (float)qcv.d / QUANT_FACTOR;
+
+        return fcv;
 }
 
 /* ============================== CLIP FUNCTIONS ======================== */
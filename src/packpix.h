@@ -9,9 +9,41 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include "uarray2.h"
 #include "uarray2b.h"
+#include "pnm.h"
 
 UArray2_T comp_vid_to_word(UArray2b_T cv_array);
 
-UArray2b_T word_to_comp_vid(UArray2_T word_array);
+UArray2b_T word_to_comp_vid(UArray2_T word_array, int pix_width, 
+                                                  int pix_height);
+
+uint32_t rgb_block_to_word(struct Pnm_rgb tl, struct Pnm_rgb tr, 
+                           struct Pnm_rgb bl, struct Pnm_rgb br, int denom);
+
+void rgb_rows_to_words(const struct Pnm_rgb *top, 
+                       const struct Pnm_rgb *bottom, int width, int denom, 
+                                                             uint32_t *words);
+
+void word_to_rgb_block(uint32_t word, struct Pnm_rgb *tl, struct Pnm_rgb *tr,
+                                      struct Pnm_rgb *bl, struct Pnm_rgb *br);
+
+bool words_valid(const uint32_t *words, size_t n);
+
+void words_to_rgb_rows(const uint32_t *words, int width, unsigned char *top,
+                                                       unsigned char *bottom);
+
+void words_to_rgb16_rows(const uint32_t *words, int width, 
+                         unsigned char *top, unsigned char *bottom);
+
+void rgb_rows_to_words_fixed(const struct Pnm_rgb *top, 
+                       const struct Pnm_rgb *bottom, int width, int denom, 
+                                                             uint32_t *words);
+
+void words_to_rgb_rows_fixed(const uint32_t *words, int width, 
+                             unsigned char *top, unsigned char *bottom);
+
+void words_to_rgb16_rows_fixed(const uint32_t *words, int width, 
+                               unsigned char *top, unsigned char *bottom);
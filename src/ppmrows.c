@@ -0,0 +1,273 @@
+/* Filename:         ppmrows.c
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      PPMROWS is a module that reads a pixmap one scanline at a
+ *                   time instead of all at once, so the compressor only ever 
+ *                   holds as many rows as it is working on. Handles both raw
+ *                   (P6) and plain (P3) pixmaps with any denominator. Raw 
+ *                   rows are read with one fread and converted from their 
+ *                   bytes, which also works on a pixmap mapped into memory.
+ *                   Writers put out the header themselves and then whole 
+ *                   scanlines of raw bytes.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include "assert.h"
+#include "ppmrows.h"
+#include "simd.h"
+
+const unsigned MAX_DENOM = 65535;
+const unsigned ONE_BYTE_DENOM = 255;
+
+/* where header bytes come from: a stream, or mapped bytes if bytes isn't 
+ * NULL 
+ */
+struct header_src
+{
+        FILE *input;
+        const unsigned char *bytes;
+        size_t len;
+        size_t at;
+};
+
+static struct ppm_header read_header(struct header_src *src);
+static int skip_space(struct header_src *src);
+static unsigned read_header_num(struct header_src *src);
+static inline int next_byte(struct header_src *src);
+static inline void put_back(struct header_src *src, int c);
+
+
+/* Description: Reads the header of a pixmap, leaving input at the first 
+ *              sample of the first row. 
+ *              
+ * Input:       PPM file pointer. CRE to pass NULL input or a file that does
+ *              not start with a P6 or P3 header.
+ * Output:      Header of the pixmap.
+ */
+struct ppm_header read_ppm_header(FILE *input)
+{
+        assert(input != NULL);
+        struct header_src src = { input, NULL, 0, 0 };
+        return read_header(&src);
+}
+
+
+/* Description: Parses the header of a pixmap at the start of a mapping, 
+ *              accepting what read_ppm_header does. 
+ *              
+ * Input:       Mapped bytes of the pixmap, and the header to fill in. CRE 
+ *              for hdr to be NULL or the bytes to not start with a P6 or P3
+ *              header.
+ * Output:      Offset of the first sample of the first row.
+ */
+size_t parse_ppm_header(struct mapped_file map, struct ppm_header *hdr)
+{
+        assert(map.bytes != NULL && hdr != NULL);
+        struct header_src src = { NULL, map.bytes, map.len, 0 };
+        *hdr = read_header(&src);
+        return src.at;
+}
+
+
+/* reads a header from either kind of source */
+static struct ppm_header read_header(struct header_src *src)
+{
+        struct ppm_header hdr;
+
+        int p = next_byte(src);
+        int magic = next_byte(src);
+        assert(p == 'P' && (magic == '6' || magic == '3'));
+
+        hdr.raw = (magic == '6');
+        hdr.width = read_header_num(src);
+        hdr.height = read_header_num(src);
+        hdr.denominator = read_header_num(src);
+        assert(hdr.denominator > 0 && hdr.denominator <= MAX_DENOM);
+
+        /* exactly one whitespace character separates header from samples */
+        int c = next_byte(src);
+        assert(c == ' ' || c == '\t' || c == '\n' || c == '\r');
+
+        return hdr;
+}
+
+
+/* Description: Reads the next scanline of a pixmap.
+ *              
+ * Input:       PPM file pointer positioned at the start of a row, header of 
+ *              the pixmap, and a row of hdr.width pixels to fill in. CRE for
+ *              the file to end before the row does, or for a plain sample 
+ *              to be over the denominator; a raw one can't be past 16 bits,
+ *              which is all the kernels need.
+ * Output:      None. The pixels are written to row.
+ */
+void read_ppm_row(FILE *input, struct ppm_header hdr, struct Pnm_rgb *row)
+{
+        assert(input != NULL && row != NULL);
+
+        if (!hdr.raw) {
+                for (unsigned i = 0; i < hdr.width; i++) {
+                        int read = fscanf(input, "%u %u %u", &row[i].red, 
+                                               &row[i].green, &row[i].blue);
+                        assert(read == 3);
+                        assert(row[i].red <= hdr.denominator 
+                               && row[i].green <= hdr.denominator
+                               && row[i].blue <= hdr.denominator);
+                }
+                return;
+        }
+
+        /* the raw bytes go at the end of the row's own memory, which is 
+         * bigger, and are converted front to back; pixel i is only stored 
+         * over bytes that belong to pixels before it, or to itself once 
+         * they've been read, and the same goes for each group of samples 
+         * the vector kernel does
+         */
+        size_t nbytes = ppm_row_bytes(hdr);
+        unsigned char *bytes = (unsigned char *)row 
+                               + hdr.width * sizeof(struct Pnm_rgb) - nbytes;
+        size_t read = fread(bytes, 1, nbytes, input);
+        assert(read == nbytes);
+
+        unpack_ppm_row(bytes, hdr, row);
+}
+
+
+/* Description: Gives the length in bytes of a raw scanline: 3 samples per 
+ *              pixel, each a byte, or two for denominators that don't fit
+ *              in a byte.
+ *              
+ * Input:       Header of a raw pixmap.
+ * Output:      Bytes in one of its rows.
+ */
+size_t ppm_row_bytes(struct ppm_header hdr)
+{
+        size_t sample_bytes = hdr.denominator <= ONE_BYTE_DENOM ? 1 : 2;
+        return (size_t)hdr.width * 3 * sample_bytes;
+}
+
+
+/* Description: Converts the bytes of a raw scanline to pixels. Two-byte 
+ *              samples are most significant byte first. Whole groups of 
+ *              SIMD_LANES pixels are done by the vector kernel when the CPU
+ *              has it, and the rest one by one.
+ *              
+ * Input:       ppm_row_bytes(hdr) bytes of a row, header of the pixmap, and
+ *              a row of hdr.width pixels to fill in. 
+ * Output:      None. The pixels are written to row.
+ */
+void unpack_ppm_row(const unsigned char *bytes, struct ppm_header hdr,
+                                                           struct Pnm_rgb *row)
+{
+        assert(bytes != NULL && row != NULL);
+
+        bool wide = hdr.denominator > ONE_BYTE_DENOM;
+        unsigned i = 0;
+        if (simd_available()) {
+                i = hdr.width / SIMD_LANES * SIMD_LANES;
+                simd_unpack_pixels(bytes, i, wide, row);
+        }
+
+        /* each pixel's samples are read before it is stored, for 
+         * read_ppm_row 
+         */
+        if (!wide) {
+                for (; i < hdr.width; i++) {
+                        const unsigned char *s = bytes + 3 * (size_t)i;
+                        struct Pnm_rgb pix = { s[0], s[1], s[2] };
+                        row[i] = pix;
+                }
+        } else {
+                for (; i < hdr.width; i++) {
+                        const unsigned char *s = bytes + 6 * (size_t)i;
+                        struct Pnm_rgb pix = { 
+                                ((unsigned)s[0] << 8) | s[1],
+                                ((unsigned)s[2] << 8) | s[3],
+                                ((unsigned)s[4] << 8) | s[5] 
+                        };
+                        row[i] = pix;
+                }
+        }
+}
+
+
+/* Description: Formats the header of a raw (P6) pixmap, after which the
+ *              caller writes its rows of bytes.
+ *              
+ * Input:       Buffer of size bytes, and the dimensions and denominator of 
+ *              the pixmap. CRE for the header and its terminating null 
+ *              character to not fit, which PPM_HEADER_MAX bytes always do.
+ * Output:      Length of the header. 
+ */
+size_t format_ppm_header(char *buf, size_t size, unsigned width, 
+                                      unsigned height, unsigned denominator)
+{
+        assert(buf != NULL);
+        int len = snprintf(buf, size, "P6\n%u %u\n%u\n", width, height, 
+                                                                denominator);
+        assert(len >= 0 && (size_t)len < size);
+        return len;
+}
+
+
+/* reads an unsigned decimal number from a header, skipping whitespace and 
+ * comments before it; CRE for it to be over INT_MAX, which keeps sizes 
+ * worked out from the dimensions from wrapping
+ */
+static unsigned read_header_num(struct header_src *src)
+{
+        int c = skip_space(src);
+        unsigned n = 0;
+
+        assert(c >= '0' && c <= '9');
+        while (c >= '0' && c <= '9') {
+                assert(n <= (INT_MAX - (unsigned)(c - '0')) / 10);
+                n = n * 10 + (c - '0');
+                c = next_byte(src);
+        }
+        put_back(src, c);
+        return n;
+}
+
+
+/* skips whitespace and '#' comments, returning the first other character */
+static int skip_space(struct header_src *src)
+{
+        int c = next_byte(src);
+        for (;;) {
+                if (c == '#') {
+                        while (c != '\n' && c != EOF)
+                                c = next_byte(src);
+                } else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                        c = next_byte(src);
+                } else {
+                        return c;
+                }
+        }
+}
+
+
+/* gets the next byte of a header, or EOF at the end of the source */
+static inline int next_byte(struct header_src *src)
+{
+        if (src->bytes == NULL)
+                return getc(src->input);
+
+        return src->at < src->len ? src->bytes[src->at++] : EOF;
+}
+
+
+/* puts back the byte next_byte just returned */
+static inline void put_back(struct header_src *src, int c)
+{
+        if (src->bytes == NULL)
+                ungetc(c, src->input);
+        else if (c != EOF)
+                src->at--;
+}
@@ -0,0 +1,47 @@
+/* Filename:         ppmrows.h
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      Header file for PPMROWS module. 
+ */
+
+#ifndef PPMROWS
+#define PPMROWS
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "pnm.h"
+#include "mapfile.h"
+
+/* what a pixmap's header says about the rows that follow it */
+struct ppm_header
+{
+        unsigned width;
+        unsigned height;
+        unsigned denominator;
+        bool     raw;           /* P6 binary samples, else P3 plain text */
+};
+
+extern struct ppm_header read_ppm_header(FILE *input);
+
+extern size_t parse_ppm_header(struct mapped_file map, 
+                                                    struct ppm_header *hdr);
+
+extern void read_ppm_row(FILE *input, struct ppm_header hdr, 
+                                                          struct Pnm_rgb *row);
+
+extern size_t ppm_row_bytes(struct ppm_header hdr);
+
+/* room for any header format_ppm_header makes */
+#define PPM_HEADER_MAX 32
+
+extern size_t format_ppm_header(char *buf, size_t size, unsigned width, 
+                                       unsigned height, unsigned denominator);
+
+extern void unpack_ppm_row(const unsigned char *bytes, struct ppm_header hdr,
+                                                          struct Pnm_rgb *row);
+
+#endif
@@ -14,6 +14,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <stdbool.h>
+#include <pthread.h>
 #include "uarray2b.h"
 #include "rgbconvert.h"
 #include "a2methods.h"
@@ -23,47 +25,111 @@
 #include "types.h"
 
 const int RGB_DENOM = 255;
+const int RGB16_DENOM = 65535;
 const int BLOCKSIZE = 2;
 
-void apply_rgb_to_cv_pix(int i, int j, UArray2b_T array, void *pixel, 
-                                                                    void *cl);
-void apply_cv_to_rgb_pix(int i, int j, UArray2b_T array, void *pixel,
-                                                                    void *cl);
-Pnm_ppm pnm_from_u2b(UArray2b_T rgb_array);
+/* each sample's part of each sum of rgb_pix_to_cv, for samples up to 
+ * TABLE_SAMPLES - 1, so that 8 bit pixels cost three lookups a sum instead of 
+ * three conversions and multiplies; the parts that are subtracted are kept 
+ * positive, so the sums are the same operations on the same doubles
+ */
+#define TABLE_SAMPLES 256
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+static double lum_of_red[TABLE_SAMPLES];
+static double lum_of_green[TABLE_SAMPLES];
+static double lum_of_blue[TABLE_SAMPLES];
+static double pb_of_red[TABLE_SAMPLES];
+static double pb_of_green[TABLE_SAMPLES];
+static double pb_of_blue[TABLE_SAMPLES];
+static double pr_of_red[TABLE_SAMPLES];
+static double pr_of_green[TABLE_SAMPLES];
+static double pr_of_blue[TABLE_SAMPLES];
+
+static void build_tables(void);
+static void fill_edge_block(struct comp_vid *cv, int width, int height);
 
-void clip_rgb(struct Pnm_rgb *pix);
+Pnm_ppm ppm_from_u2b(UArray2b_T rgb_array);
+
+void clip_rgb(struct Pnm_rgb *pix, unsigned denom);
 
 
 /* Description: Converts a PPM pixmap w/ RGB pixels to UArray2b of component
- *              video pixels. 
+ *              video pixels. Walks the target's blocks with a cursor; when 
+ *              the pixmap is blocked the same way (it is, when read with 
+ *              the blocked methods) its blocks are walked in step, so both
+ *              sides are straight runs of memory. A block cut off by an odd
+ *              width or height has its unused cells filled in from its edge,
+ *              so it can be coded whole. 
  *              
  * Input:       PPM pixmap - the original image to be compressed. 
  * Output:      UArray2b of component-video structs. One tier down. 
  */
 UArray2b_T rgb_to_comp_vid(Pnm_ppm pixmap)
 {
-        Pnm_ppm cv_pixmap = malloc(sizeof(*cv_pixmap));
-        cv_pixmap->denominator = pixmap->denominator;
-
-        cv_pixmap->pixels = UArray2b_new(pixmap->width, pixmap->height, 
+        UArray2b_T rgb_array = pixmap->pixels;
+        double scale = rgb_pix_scale(pixmap->denominator);
+        UArray2b_T cv_array = UArray2b_new(pixmap->width, pixmap->height, 
                                           sizeof(struct comp_vid), BLOCKSIZE);
-        
-        UArray2b_map(pixmap->pixels, &apply_rgb_to_cv_pix, cv_pixmap);
+        struct UArray2b_cursor src = UArray2b_cursor_start(rgb_array);
+        bool in_step = src.blocksize == BLOCKSIZE;
+
+        UArray2b_FOR_EACH_BLOCK(cv_array, cur) {
+                struct comp_vid *cv = cur.cells;
+                const struct Pnm_rgb *rgb = src.cells;
+                for (int di = 0; di < cur.width; di++) {
+                        for (int dj = 0; dj < cur.height; dj++) {
+                                int c = di * BLOCKSIZE + dj;
+                                struct Pnm_rgb pix = in_step ? rgb[c] 
+                                        : *(struct Pnm_rgb *)UArray2b_at(
+                                          rgb_array, cur.i + di, cur.j + dj);
+                                cv[c] = rgb_pix_to_cv(pix, scale);
+                        }
+                }
+                if (cur.width < BLOCKSIZE || cur.height < BLOCKSIZE) {
+                        fill_edge_block(cv, cur.width, cur.height);
+                }
+                if (in_step) {
+                        UArray2b_cursor_next(&src);
+                }
+        }
 
-        UArray2b_T pixels = cv_pixmap->pixels;
-        free(cv_pixmap);
-        
-        return pixels;
+        return cv_array;
 }
 
 
+/* Description: Converts a UArray2b of component video pixels to a pixmap of
+ *              RGB pixels with denominator RGB_DENOM, walking the blocks of
+ *              both in step (or looking the source cells up one at a time,
+ *              if it is blocked differently). 
+ *              
+ * Input:       UArray2b of component-video structs.
+ * Output:      PPM pixmap with blocked methods. 
+ */
 Pnm_ppm comp_vid_to_rgb(UArray2b_T b_img)
 {
         int width = b_img->width;
         int height = b_img->height;
         int size = sizeof(struct Pnm_rgb);
         UArray2b_T rgb_array = UArray2b_new(width, height, size, BLOCKSIZE);
-        UArray2b_map(b_img, &apply_cv_to_rgb_pix, rgb_array);
+        struct UArray2b_cursor src = UArray2b_cursor_start(b_img);
+        bool in_step = src.blocksize == BLOCKSIZE;
+
+        UArray2b_FOR_EACH_BLOCK(rgb_array, cur) {
+                struct Pnm_rgb *rgb = cur.cells;
+                const struct comp_vid *cv = src.cells;
+                for (int di = 0; di < cur.width; di++) {
+                        for (int dj = 0; dj < cur.height; dj++) {
+                                int c = di * BLOCKSIZE + dj;
+                                struct comp_vid pix = in_step ? cv[c] 
+                                        : *(struct comp_vid *)UArray2b_at(
+                                          b_img, cur.i + di, cur.j + dj);
+                                rgb[c] = cv_pix_to_rgb(pix);
+                        }
+                }
+                if (in_step) {
+                        UArray2b_cursor_next(&src);
+                }
+        }
 
         Pnm_ppm pixmap = ppm_from_u2b(rgb_array);
         return pixmap;
@@ -88,70 +154,173 @@ Pnm_ppm ppm_from_u2b(UArray2b_T rgb_array)
 }
 
 
-/* Description: Apply function that, when mapped to a Uarray2b of RGB pixels,
- *              turns each RGB pixel into a component-video pixel. 
+/* Description: Gets ready to convert the pixels of a pixmap, making the 
+ *              tables of rgb_pix_to_cv the first time. 
  *              
- * Input:       Takes i and j indices of the pixel, pointer to the RGB pixel
- *              itself, new target array passed as closure where we'll place
- *              comp_vid structs. 
- * Output:      UArray2b of component-video struct as closure.
+ * Input:       Denominator of the pixmap. CRE for it to be below 1.
+ * Output:      The scale to pass rgb_pix_to_cv for the pixmap's pixels. 
  */
-void apply_rgb_to_cv_pix(int i, int j, UArray2b_T array, void *pixel, 
-                                                                     void *cl)
+double rgb_pix_scale(int denom)
 {
-        assert(pixel != NULL);
-        Pnm_rgb rgbpix_p = pixel;
-        struct Pnm_rgb rgbpix = *rgbpix_p;
-        Pnm_ppm cv_pixmap = cl;
-        int denom = cv_pixmap->denominator;
-        UArray2b_T cv_array = cv_pixmap->pixels;
-        struct comp_vid *cvpixel = UArray2b_at(cv_array, i, j);
-        assert(cvpixel != NULL);
+        assert(denom > 0);
+        pthread_once(&tables_once, build_tables);
+        return 1.0 / denom;
+}
+
+
+/* Description: Converts a single RGB pixel to a component-video pixel, 
+ *              scaling by the denominator of the pixmap it came from. Shared
+ *              by the tiered and the fused compression paths. Samples that 
+ *              fit in 8 bits are looked up in tables. 
+ *              
+ *              Each component is rounded to float and then divided by the 
+ *              denominator. Multiplying by the reciprocal in double and 
+ *              rounding to float again gives the same bits: a float over a 
+ *              denominator below 2^16 is never close enough to halfway 
+ *              between two floats for the double's error to matter.
+ *              
+ * Input:       RGB pixel and the scale rgb_pix_scale gave for its pixmap.
+ * Output:      Component-video pixel.
+ */
+struct comp_vid rgb_pix_to_cv(struct Pnm_rgb rgbpix, double scale)
+{
+        struct comp_vid cv;
+        unsigned r = rgbpix.red;
+        unsigned g = rgbpix.green;
+        unsigned b = rgbpix.blue;
 
         /* many calculation for rgb to component video */
-        cvpixel->lum = (0.299 * rgbpix.red) + (0.587 * rgbpix.green)  
-                                                      + (0.114 * rgbpix.blue);
-        cvpixel->pb = -(0.168736 * rgbpix.red) - (0.331264 * rgbpix.green) 
-                                                        + (0.5 * rgbpix.blue);
-        cvpixel->pr = (0.5 * rgbpix.red) - (0.418688 * rgbpix.green) 
-                                                   - (0.081312 * rgbpix.blue);
+        if ((r | g | b) < TABLE_SAMPLES) {
+                cv.lum = lum_of_red[r] + lum_of_green[g] + lum_of_blue[b];
+                cv.pb = -pb_of_red[r] - pb_of_green[g] + pb_of_blue[b];
+                cv.pr = pr_of_red[r] - pr_of_green[g] - pr_of_blue[b];
+        } else {
+                cv.lum = (0.299 * r) + (0.587 * g) + (0.114 * b);
+                cv.pb = -(0.168736 * r) - (0.331264 * g) + (0.5 * b);
+                cv.pr = (0.5 * r) - (0.418688 * g) - (0.081312 * b);
+        }
 
         //ambiguate denominator so we can assume 255 on decompression
-        cvpixel->lum = cvpixel->lum / denom;
-        cvpixel->pb = cvpixel->pb / denom;
-        cvpixel->pr = cvpixel->pr / denom;
-        (void) array;
+        cv.lum = cv.lum * scale;
+        cv.pb = cv.pb * scale;
+        cv.pr = cv.pr * scale;
+        return cv;
 }
 
 
-/* Description: Apply function that, when mapped to a Uarray2b of component
- *              video pixels, turns each cv pixel into an RGB pixel. 
+/* Description: Fills in the cells of a block past the edge of its array, 
+ *              which a UArray2b has room for, by repeating the last column 
+ *              and then the last row of the cells in use. 
  *              
- * Input:       Takes i and j indices of the pixel, pointer to the CV pixel
- *              itself, new target array passed as closure where we'll place
- *              RGB structs. 
- * Output:      UArray2b of RGB structs as closure.
+ * Input:       Cells of a block, and how many columns and rows of it are 
+ *              in the array.
+ * Output:      None. The unused cells are written.
  */
-void apply_cv_to_rgb_pix(int i, int j, UArray2b_T array, void *pixel, 
-                                                                     void *cl)
+static void fill_edge_block(struct comp_vid *cv, int width, int height)
+{
+        for (int di = 0; di < BLOCKSIZE; di++) {
+                for (int dj = 0; dj < BLOCKSIZE; dj++) {
+                        if (di < width && dj < height) {
+                                continue;
+                        }
+                        int si = di < width ? di : width - 1;
+                        int sj = dj < height ? dj : height - 1;
+                        cv[di * BLOCKSIZE + dj] = cv[si * BLOCKSIZE + sj];
+                }
+        }
+}
+
+
+/* fills in the tables of rgb_pix_to_cv; run once, with pthread_once */
+static void build_tables(void)
 {
-        (void)array;
-        assert(pixel != NULL);
-        struct comp_vid *cvpix = pixel;
-        UArray2b_T rgb_array = cl;
+        for (unsigned v = 0; v < TABLE_SAMPLES; v++) {
+                lum_of_red[v]   = 0.299 * v;
+                lum_of_green[v] = 0.587 * v;
+                lum_of_blue[v]  = 0.114 * v;
+                pb_of_red[v]    = 0.168736 * v;
+                pb_of_green[v]  = 0.331264 * v;
+                pb_of_blue[v]   = 0.5 * v;
+                pr_of_red[v]    = 0.5 * v;
+                pr_of_green[v]  = 0.418688 * v;
+                pr_of_blue[v]   = 0.081312 * v;
+        }
+}
 
-        assert(cvpix != NULL);
 
-        cvpix->lum = cvpix->lum * RGB_DENOM;
-        cvpix->pb = cvpix->pb * RGB_DENOM;
-        cvpix->pr = cvpix->pr * RGB_DENOM;      
+/* Description: Converts a single component-video pixel to an RGB pixel with
+ *              denominator RGB_DENOM. Shared by the tiered and the fused 
+ *              decompression paths.
+ *              
+ * Input:       Component-video pixel.
+ * Output:      Clipped RGB pixel.
+ */
+struct Pnm_rgb cv_pix_to_rgb(struct comp_vid cv)
+{
+        return lum_to_rgb(cv.lum, pb_terms(cv.pb, RGB_DENOM), 
+                          pr_terms(cv.pr, RGB_DENOM), RGB_DENOM);
+}
+
+
+/* Description: Works out the parts of a pixel's samples that its Pb makes, 
+ *              as cv_pix_to_rgb does, so that pixels of the same Pb can 
+ *              share them. 
+ *              
+ * Input:       Pb of a component-video pixel, and the denominator of the 
+ *              pixel it goes to.
+ * Output:      Its terms of green and blue; red is 0.
+ */
+struct chroma_terms pb_terms(float pb, int denom)
+{
+        struct chroma_terms terms;
+        pb = pb * denom;
+
+        terms.red = 0;
+        terms.green = 0.344136 * pb;
+        terms.blue = 1.772 * pb;
+        return terms;
+}
+
+
+/* Description: Works out the parts of a pixel's samples that its Pr makes, 
+ *              as cv_pix_to_rgb does, so that pixels of the same Pr can 
+ *              share them. 
+ *              
+ * Input:       Pr of a component-video pixel, and the denominator of the 
+ *              pixel it goes to.
+ * Output:      Its terms of red and green; blue is 0.
+ */
+struct chroma_terms pr_terms(float pr, int denom)
+{
+        struct chroma_terms terms;
+        pr = pr * denom;
+
+        terms.red = 1.402 * pr;
+        terms.green = 0.714136 * pr;
+        terms.blue = 0;
+        return terms;
+}
+
+
+/* Description: Converts the luma of a component-video pixel and the terms 
+ *              of its chroma to an RGB pixel with the given denominator, 
+ *              RGB_DENOM or RGB16_DENOM. 
+ *              
+ * Input:       Luma, the terms from pb_terms and pr_terms, and the 
+ *              denominator they were worked out for.
+ * Output:      Clipped RGB pixel.
+ */
+struct Pnm_rgb lum_to_rgb(float lum, struct chroma_terms pb, 
+                          struct chroma_terms pr, int denom)
+{
+        struct Pnm_rgb rgb;
+
+        lum = lum * denom;
         
         /* many calculations to go from component video to rgb */
-        struct Pnm_rgb *elem = UArray2b_at(rgb_array, i, j);
-        signed r = (1.0 * cvpix->lum) + (1.402 * cvpix->pr);
-        signed g = (1.0 * cvpix->lum) - (0.344136 * cvpix->pb) 
-                                                     - (0.714136 * cvpix->pr);
-        signed b = (1.0 * cvpix->lum) + (1.772 * cvpix->pb);
+        signed r = (1.0 * lum) + pr.red;
+        signed g = (1.0 * lum) - pb.green - pr.green;
+        signed b = (1.0 * lum) + pb.blue;
 
         //limit values while still signed to prevent negative signed values
         //rolling back to extremely large unsigned values.
@@ -162,38 +331,39 @@ void apply_cv_to_rgb_pix(int i, int j, UArray2b_T array, void *pixel,
         if (g < 0)
                 g = 0;
 
-        elem->red   = r;
-        elem->green = g;
-        elem->blue  = b;
+        rgb.red   = r;
+        rgb.green = g;
+        rgb.blue  = b;
 
-        clip_rgb(elem);
+        clip_rgb(&rgb, denom);
+        return rgb;
 }
 
 
-/* Description: Limits values of a pixel to values between 0 and RGB_DENOM
- *              (255). 
+/* Description: Limits values of a pixel to values between 0 and the given 
+ *              denominator. 
  *              
- * Input:       RGB pixel pointer.
+ * Input:       RGB pixel pointer, and its denominator.
  * Output:      Nothing.
  */
-void clip_rgb(struct Pnm_rgb *pix)
+void clip_rgb(struct Pnm_rgb *pix, unsigned denom)
 {
         if (pix->red < 0) {
                 pix->red = 0;
-        } else if (pix->red > RGB_DENOM) {
-                pix->red = RGB_DENOM;
+        } else if (pix->red > denom) {
+                pix->red = denom;
         }
 
         if (pix->green < 0) {
                 pix->green = 0;
-        } else if (pix->green > RGB_DENOM) {
-                pix->green = RGB_DENOM;
+        } else if (pix->green > denom) {
+                pix->green = denom;
         }
 
         if (pix->blue < 0) {
                 pix->blue = 0;
-        } else if (pix->blue > RGB_DENOM) {
-                pix->blue = RGB_DENOM;
+        } else if (pix->blue > denom) {
+                pix->blue = denom;
         }
 }
 
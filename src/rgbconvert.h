@@ -10,11 +10,37 @@
 #ifndef RGBCONVERT
 #define RGBCONVERT
 
+#include "uarray2.h"
 #include "uarray2b.h"
 #include "pnm.h"
+#include "types.h"
+
+extern const int RGB_DENOM;
+extern const int RGB16_DENOM;
 
 extern UArray2b_T rgb_to_comp_vid(Pnm_ppm pixmap);
 
 extern Pnm_ppm comp_vid_to_rgb(UArray2b_T b_img);
 
+/* the parts of each sample of a pixel that its Pb or its Pr makes */
+struct chroma_terms
+{
+        double red;
+        double green;
+        double blue;
+};
+
+extern double rgb_pix_scale(int denom);
+
+extern struct comp_vid rgb_pix_to_cv(struct Pnm_rgb rgbpix, double scale);
+
+extern struct Pnm_rgb cv_pix_to_rgb(struct comp_vid cv);
+
+extern struct chroma_terms pb_terms(float pb, int denom);
+
+extern struct chroma_terms pr_terms(float pr, int denom);
+
+extern struct Pnm_rgb lum_to_rgb(float lum, struct chroma_terms pb, 
+                                 struct chroma_terms pr, int denom);
+
 #endif
\ No newline at end of file
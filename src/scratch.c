@@ -0,0 +1,135 @@
+/* Filename:         scratch.c
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      SCRATCH hands out memory from one block by bumping an 
+ *                   offset, and takes it all back at once. An allocation 
+ *                   that does not fit gets its own overflow chunk, and the 
+ *                   next reset trades the block and the chunks in for one 
+ *                   block big enough for all of them. So the block grows to
+ *                   the largest image seen and then stays put: later images
+ *                   neither call the allocator nor fault in fresh pages. 
+ */
+
+#include <stdlib.h>
+#include "assert.h"
+#include "mem.h"
+#include "scratch.h"
+
+#define T Scratch_T
+
+/* every allocation is rounded up to a multiple of this, as in Hanson */
+union align {
+        long l;
+        double d;
+        long double ld;
+        void *p;
+        void (*f)(void);
+};
+
+/* an allocation that did not fit in the block; its memory follows it */
+struct overflow {
+        struct overflow *next;
+        union align start[];
+};
+
+struct T {
+        char *block;
+        size_t size;            /* bytes in block */
+        size_t used;            /* bytes of block handed out */
+        size_t wanted;          /* bytes handed out, overflow included */
+        struct overflow *chunks;
+};
+
+static void free_chunks(T scratch);
+
+
+T Scratch_new(void)
+{
+        T scratch;
+        NEW(scratch);
+        scratch->block = NULL;
+        scratch->size = 0;
+        scratch->used = 0;
+        scratch->wanted = 0;
+        scratch->chunks = NULL;
+        return scratch;
+}
+
+
+void Scratch_free(T *scratch)
+{
+        assert(scratch != NULL && *scratch != NULL);
+        free_chunks(*scratch);
+        free((*scratch)->block);
+        FREE(*scratch);
+}
+
+
+void *Scratch_alloc(T scratch, size_t nbytes)
+{
+        assert(scratch != NULL);
+        size_t align = sizeof(union align);
+        assert(nbytes <= (size_t)-1 - align);
+        if (nbytes == 0)
+                nbytes = 1;     /* a distinct pointer, as from malloc */
+        nbytes = (nbytes + align - 1) / align * align;
+        assert(nbytes <= (size_t)-1 - scratch->wanted);
+
+        if (nbytes <= scratch->size - scratch->used) {
+                void *p = scratch->block + scratch->used;
+                scratch->used += nbytes;
+                scratch->wanted += nbytes;
+                return p;
+        }
+
+        /* counted only once it is had, so a failed request doesn't leave
+           Scratch_reset trying to make a block that big */
+        assert(nbytes <= (size_t)-1 - sizeof(struct overflow));
+        struct overflow *chunk = malloc(sizeof(*chunk) + nbytes);
+        assert(chunk != NULL);
+        scratch->wanted += nbytes;
+        chunk->next = scratch->chunks;
+        scratch->chunks = chunk;
+        return chunk->start;
+}
+
+
+void Scratch_reset(T scratch)
+{
+        assert(scratch != NULL);
+        if (scratch->chunks != NULL) {
+                free_chunks(scratch);
+                free(scratch->block);
+                /* with no block, allocations take chunks until the next 
+                   reset tries again */
+                scratch->block = malloc(scratch->wanted);
+                scratch->size = scratch->block != NULL ? scratch->wanted : 0;
+        }
+        scratch->used = 0;
+        scratch->wanted = 0;
+}
+
+
+size_t Scratch_capacity(T scratch)
+{
+        assert(scratch != NULL);
+        return scratch->size;
+}
+
+
+/* Description: Frees the overflow chunks. 
+ *              
+ * Input:       Arena.
+ * Output:      None.
+ */
+static void free_chunks(T scratch)
+{
+        while (scratch->chunks != NULL) {
+                struct overflow *chunk = scratch->chunks;
+                scratch->chunks = chunk->next;
+                free(chunk);
+        }
+}
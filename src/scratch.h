@@ -0,0 +1,37 @@
+/* Filename:         scratch.h
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      Interface for SCRATCH, an arena for the buffers one 
+ *                   image needs, reused from image to image. 
+ */
+
+#ifndef SCRATCH_INCLUDED
+#define SCRATCH_INCLUDED
+
+#include <stddef.h>
+
+#define T Scratch_T
+typedef struct T *T;
+
+extern T     Scratch_new  (void);
+extern void  Scratch_free (T *scratch);
+
+extern void *Scratch_alloc(T scratch, size_t nbytes);
+  /* nbytes of uninitialized memory, aligned for any type, that stay good
+     until the next Scratch_reset; running out of memory is a checked 
+     run-time error */
+extern void  Scratch_reset(T scratch);
+  /* takes back everything allocated since the last reset, keeping the 
+     memory; if the allocations outgrew it, it grows to fit them all, so 
+     an image no bigger than any seen before allocates nothing */
+extern size_t Scratch_capacity(T scratch);
+  /* bytes the arena holds ready for allocations after a reset */
+
+/* it is a checked run-time error to pass a NULL T
+   to any function in this interface */
+
+#undef T
+#endif
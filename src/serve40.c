@@ -0,0 +1,458 @@
+/* Filename:         serve40.c
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      SERVE40 runs 40image as a daemon on a Unix-domain 
+ *                   socket, so a client coding image after image pays for 
+ *                   starting up, making threads and growing buffers once.
+ *
+ *                   A request is an opcode byte, 'c' to compress a PPM or 
+ *                   'd' to decompress a COMP40 image, then the payload's 
+ *                   length as 4 bytes, most significant first, then the 
+ *                   payload. A reply is a status byte, 0 for success and 1
+ *                   for a malformed payload, then a length in the same form,
+ *                   then the coded image or a message. A client may send
+ *                   any number of requests without waiting; each 
+ *                   connection's replies come back in the order of its 
+ *                   requests. An unknown opcode gets an error reply and 
+ *                   the connection is closed once it has been sent.
+ *
+ *                   One thread polls every connection and codes each whole
+ *                   request as it arrives, straight from the bytes read, 
+ *                   with compress40's pool of threads and buffers. A 
+ *                   malformed payload is a CRE inside the pipeline, caught
+ *                   here as Assert_Failed. CII's exceptions are 
+ *                   single-threaded, so every check of payload bytes runs 
+ *                   on this thread, before any work is handed to the pool:
+ *                   a header's sizes are bounded as they are parsed, so 
+ *                   that no count of blocks or words can wrap; the 
+ *                   payload's length is checked against them before any 
+ *                   buffer is sized from them, a plain pixel counting for 
+ *                   at least six bytes; plain samples are checked against 
+ *                   maxval as they are read; and each batch of words is 
+ *                   checked with words_valid before its rows are unpacked.
+ *                   serve40test sends payloads that break each of these.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <compress40.h>
+#include "assert.h"
+#include "except.h"
+
+#define FRAME_HEADER 5          /* opcode or status byte, then a length */
+
+const unsigned char SERVE_COMPRESS   = 'c';
+const unsigned char SERVE_DECOMPRESS = 'd';
+const unsigned char SERVE_OK    = 0;
+const unsigned char SERVE_ERROR = 1;
+const size_t READ_CHUNK = 64 * 1024;
+const size_t REPLY_HIGH_WATER = 16 * 1024 * 1024;
+        /* a client with this much unsent is not read from until it 
+           catches up */
+
+/* bytes read or to be written, in a buffer that grows */
+struct buffer
+{
+        unsigned char *bytes;
+        size_t len;
+        size_t cap;
+};
+
+struct conn
+{
+        int fd;
+        struct buffer in;       /* requests, the first one starting at 0 */
+        struct buffer out;      /* replies, of which sent bytes are gone */
+        size_t sent;
+        bool eof;               /* nothing more will be read */
+        bool dead;              /* close without writing anything more */
+};
+
+/* the connections being served, and the reply buffer they share */
+struct server
+{
+        int listener;
+        struct conn *conns;
+        unsigned nconns;
+        unsigned cap;
+        struct pollfd *fds;     /* the listener, then one per conn */
+        unsigned char *result;
+        size_t result_cap;
+};
+
+int serve40(const char *path);
+static int listen_on(const char *path);
+static void accept_conns(struct server *server);
+static void read_requests(struct conn *conn);
+static void serve_requests(struct server *server, struct conn *conn);
+static bool code_request(struct server *server, unsigned char op, 
+                         const unsigned char *payload, size_t len, 
+                         size_t *n);
+static void write_replies(struct conn *conn);
+static void put_reply(struct conn *conn, unsigned char status, 
+                                        const void *payload, size_t len);
+static void put_bytes(struct buffer *buf, const void *bytes, size_t n);
+static void reserve(struct buffer *buf, size_t n);
+static void close_conn(struct server *server, unsigned k);
+static bool set_nonblocking(int fd);
+
+
+/* Description: Serves compression and decompression requests on a socket 
+ *              at path until something goes wrong with the socket itself.
+ *              A stale socket left at path by an earlier server is 
+ *              replaced; one a live server is listening on is not.
+ *              
+ * Input:       Path of the socket. CRE to pass NULL.
+ * Output:      Exit status for the program, 1, after reporting the error. 
+ */
+int serve40(const char *path)
+{
+        assert(path != NULL);
+        struct server server = { -1, NULL, 0, 0, NULL, NULL, 0 };
+        server.listener = listen_on(path);
+        if (server.listener < 0) {
+                return 1;
+        }
+        server.fds = malloc(sizeof(*server.fds));
+        assert(server.fds != NULL);
+
+        for (;;) {
+                unsigned polled = server.nconns;
+                server.fds[0].fd = server.listener;
+                server.fds[0].events = POLLIN;
+                for (unsigned k = 0; k < polled; k++) {
+                        struct conn *conn = &server.conns[k];
+                        size_t unsent = conn->out.len - conn->sent;
+                        server.fds[k + 1].fd = conn->fd;
+                        server.fds[k + 1].events = 
+                                (!conn->eof && unsent < REPLY_HIGH_WATER 
+                                                          ? POLLIN : 0)
+                                | (unsent > 0 ? POLLOUT : 0);
+                }
+
+                if (poll(server.fds, polled + 1, -1) < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        perror("poll");
+                        break;
+                }
+
+                /* backwards, so closing k moves an already served conn 
+                   into its place */
+                for (unsigned k = polled; k-- > 0; ) {
+                        struct conn *conn = &server.conns[k];
+                        if (server.fds[k + 1].revents != 0 && !conn->eof) {
+                                read_requests(conn);
+                        }
+                        serve_requests(&server, conn);
+                        write_replies(conn);
+                        if (conn->dead 
+                            || (conn->eof && conn->sent == conn->out.len)) {
+                                close_conn(&server, k);
+                        }
+                }
+
+                if (server.fds[0].revents & POLLIN) {
+                        accept_conns(&server);
+                }
+        }
+
+        while (server.nconns > 0) {
+                close_conn(&server, server.nconns - 1);
+        }
+        close(server.listener);
+        free(server.conns);
+        free(server.fds);
+        free(server.result);
+        return 1;
+}
+
+
+/* Description: Makes a non-blocking socket listening at path, first 
+ *              removing a socket file there that no server answers on. 
+ *              
+ * Input:       Path of the socket.
+ * Output:      The socket, or -1 after reporting why there isn't one. 
+ */
+static int listen_on(const char *path)
+{
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+                fprintf(stderr, "%s: socket path too long\n", path);
+                return -1;
+        }
+        strcpy(addr.sun_path, path);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+                perror("socket");
+                return -1;
+        }
+
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+                if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) 
+                                                                     == 0) {
+                        fprintf(stderr, "%s: a server is already running "
+                                        "there\n", path);
+                        close(fd);
+                        return -1;
+                }
+                unlink(path);
+        }
+
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 
+            || listen(fd, SOMAXCONN) < 0 || !set_nonblocking(fd)) {
+                perror(path);
+                close(fd);
+                return -1;
+        }
+        return fd;
+}
+
+
+/* Description: Accepts every connection waiting on the listener. 
+ *              
+ * Input:       Server.
+ * Output:      None. The connections are added to the server's.
+ */
+static void accept_conns(struct server *server)
+{
+        for (;;) {
+                int fd = accept(server->listener, NULL, NULL);
+                if (fd < 0) {
+                        if (errno == EINTR) {
+                                continue;
+                        }
+                        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                                perror("accept");
+                        }
+                        return;
+                }
+                if (!set_nonblocking(fd)) {
+                        close(fd);
+                        continue;
+                }
+
+                if (server->nconns == server->cap) {
+                        server->cap = server->cap == 0 ? 8 : 2 * server->cap;
+                        server->conns = realloc(server->conns, 
+                                      server->cap * sizeof(*server->conns));
+                        server->fds = realloc(server->fds, 
+                                  (server->cap + 1) * sizeof(*server->fds));
+                        assert(server->conns != NULL && server->fds != NULL);
+                }
+                struct conn *conn = &server->conns[server->nconns++];
+                memset(conn, 0, sizeof(*conn));
+                conn->fd = fd;
+        }
+}
+
+
+/* Description: Reads whatever a client has sent, to the end of the input 
+ *              buffer. 
+ *              
+ * Input:       Connection.
+ * Output:      None. Sets eof when the client shuts its end, dead on an 
+ *              error. 
+ */
+static void read_requests(struct conn *conn)
+{
+        for (;;) {
+                reserve(&conn->in, READ_CHUNK);
+                ssize_t n = read(conn->fd, conn->in.bytes + conn->in.len, 
+                                               conn->in.cap - conn->in.len);
+                if (n > 0) {
+                        conn->in.len += n;
+                } else if (n == 0) {
+                        conn->eof = true;
+                        return;
+                } else if (errno != EINTR) {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                                conn->dead = true;
+                        }
+                        return;
+                }
+        }
+}
+
+
+/* Description: Codes every whole request at the front of a connection's 
+ *              input, in order, queuing a reply to each, and keeps any 
+ *              partial request for when the rest of it comes. 
+ *              
+ * Input:       Server, for the shared reply buffer, and connection.
+ * Output:      None. 
+ */
+static void serve_requests(struct server *server, struct conn *conn)
+{
+        size_t at = 0;
+        while (!conn->dead && conn->in.len - at >= FRAME_HEADER) {
+                const unsigned char *frame = conn->in.bytes + at;
+                unsigned char op = frame[0];
+                size_t len = (size_t)frame[1] << 24 | (size_t)frame[2] << 16
+                             | (size_t)frame[3] << 8 | frame[4];
+
+                if (op != SERVE_COMPRESS && op != SERVE_DECOMPRESS) {
+                        const char *msg = "unknown request";
+                        put_reply(conn, SERVE_ERROR, msg, strlen(msg));
+                        conn->eof = true;      /* can't find the next one */
+                        at = conn->in.len;
+                        break;
+                }
+                if (conn->in.len - at - FRAME_HEADER < len) {
+                        break;
+                }
+
+                size_t n;
+                if (code_request(server, op, frame + FRAME_HEADER, len, &n)) {
+                        put_reply(conn, SERVE_OK, server->result, n);
+                } else {
+                        const char *msg = op == SERVE_COMPRESS 
+                                          ? "malformed PPM" 
+                                          : "malformed COMP40 image";
+                        put_reply(conn, SERVE_ERROR, msg, strlen(msg));
+                }
+                at += FRAME_HEADER + len;
+        }
+
+        memmove(conn->in.bytes, conn->in.bytes + at, conn->in.len - at);
+        conn->in.len -= at;
+}
+
+
+/* Description: Compresses or decompresses one request's payload into the 
+ *              server's reply buffer, catching the CRE a malformed payload
+ *              makes. 
+ *              
+ * Input:       Server, opcode, the len bytes of payload, and where to put 
+ *              the length of the result.
+ * Output:      Whether the payload could be coded. 
+ */
+static bool code_request(struct server *server, unsigned char op, 
+                         const unsigned char *payload, size_t len, 
+                         size_t *n)
+{
+        volatile bool ok = true;
+        TRY
+                if (op == SERVE_COMPRESS) {
+                        *n = compress40_bytes(payload, len, &server->result,
+                                                        &server->result_cap);
+                } else {
+                        *n = decompress40_bytes(payload, len, &server->result,
+                                                        &server->result_cap);
+                }
+        EXCEPT(Assert_Failed)
+                ok = false;
+        END_TRY;
+        return ok;
+}
+
+
+/* Description: Sends as much of a connection's replies as the socket takes
+ *              without blocking. 
+ *              
+ * Input:       Connection.
+ * Output:      None. Sets dead if the client has gone away. 
+ */
+static void write_replies(struct conn *conn)
+{
+        while (!conn->dead && conn->sent < conn->out.len) {
+                ssize_t n = send(conn->fd, conn->out.bytes + conn->sent, 
+                                 conn->out.len - conn->sent, MSG_NOSIGNAL);
+                if (n >= 0) {
+                        conn->sent += n;
+                } else if (errno != EINTR) {
+                        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                                conn->dead = true;
+                        }
+                        return;
+                }
+        }
+
+        if (conn->sent == conn->out.len) {
+                conn->out.len = 0;
+                conn->sent = 0;
+        }
+}
+
+
+/* Description: Queues a reply on a connection. 
+ *              
+ * Input:       Connection, status byte, and the len bytes of payload. CRE 
+ *              for len to not fit in the 4 bytes of a reply's length.
+ * Output:      None. 
+ */
+static void put_reply(struct conn *conn, unsigned char status, 
+                                         const void *payload, size_t len)
+{
+        assert(len <= UINT32_MAX);
+        unsigned char header[FRAME_HEADER] = { 
+                status, len >> 24, len >> 16 & 0xff, len >> 8 & 0xff, 
+                len & 0xff 
+        };
+        put_bytes(&conn->out, header, sizeof(header));
+        put_bytes(&conn->out, payload, len);
+}
+
+
+/* appends n bytes to a buffer */
+static void put_bytes(struct buffer *buf, const void *bytes, size_t n)
+{
+        reserve(buf, n);
+        memcpy(buf->bytes + buf->len, bytes, n);
+        buf->len += n;
+}
+
+
+/* makes room for at least n more bytes in a buffer, at least doubling it */
+static void reserve(struct buffer *buf, size_t n)
+{
+        if (buf->cap - buf->len >= n) {
+                return;
+        }
+        size_t cap = 2 * buf->cap;
+        if (cap < buf->len + n) {
+                cap = buf->len + n;
+        }
+        buf->bytes = realloc(buf->bytes, cap);
+        assert(buf->bytes != NULL);
+        buf->cap = cap;
+}
+
+
+/* closes connection k and moves the last connection into its place */
+static void close_conn(struct server *server, unsigned k)
+{
+        struct conn *conn = &server->conns[k];
+        close(conn->fd);
+        free(conn->in.bytes);
+        free(conn->out.bytes);
+        server->conns[k] = server->conns[--server->nconns];
+}
+
+
+/* makes reads and writes on fd return rather than wait */
+static bool set_nonblocking(int fd)
+{
+        int flags = fcntl(fd, F_GETFL);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
@@ -0,0 +1,225 @@
+/* Filename:         serve40test.c
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      Checks that SERVE40 on several threads turns malformed
+ *                   payloads into error replies and keeps serving. Forks a
+ *                   server on 8 threads, compresses a 512x512 image on it,
+ *                   sets one word's chroma index past the levels, sends the
+ *                   bad image twice and expects two error replies; then 
+ *                   sends headers whose sizes overflow or far outrun their
+ *                   payloads, and a sample over its maxval, and expects an
+ *                   error reply for each; then sends the good image and 
+ *                   expects it to decompress. Once with the float engine 
+ *                   and once with the fixed-point one. Built like 
+ *                   bitpacktest, from every object but 40image.o.
+ *
+ *                   Usage: ./serve40test [socket]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <assert.h>
+#include <compress40.h>
+
+extern int serve40(const char *path);
+
+const unsigned TEST_THREADS = 8;
+const unsigned TEST_SIDE = 512;
+
+static void check_bad_word(const char *path, bool fixed);
+static void check_bad_headers(int fd);
+static int connect_to(const char *path);
+static void send_request(int fd, unsigned char op, const unsigned char *bytes,
+                                                                  size_t len);
+static unsigned char get_reply(int fd, unsigned char **bytes, size_t *len);
+static void read_all(int fd, void *bytes, size_t len);
+static unsigned char *make_ppm(size_t *len);
+
+int main(int argc, char *argv[])
+{
+        const char *path = argc > 1 ? argv[1] : "/tmp/serve40test.sock";
+        check_bad_word(path, false);
+        check_bad_word(path, true);
+        fprintf(stderr, "%s\n", "Passed.");
+        return 0;
+}
+
+/* runs the checks against a server of its own, on the float engine or the
+   fixed-point one, whose kernels each assert on a bad chroma index */
+static void check_bad_word(const char *path, bool fixed)
+{
+        pid_t server = fork();
+        assert(server >= 0);
+        if (server == 0) {
+                set_threads40(TEST_THREADS);
+                set_fixed40(fixed);
+                exit(serve40(path));
+        }
+        int fd = connect_to(path);
+
+        size_t ppm_len, len;
+        unsigned char *ppm = make_ppm(&ppm_len);
+        unsigned char *image;
+        send_request(fd, 'c', ppm, ppm_len);
+        assert(get_reply(fd, &image, &len) == 0);
+
+        /* the words start after the two lines of the header; the index in
+           the low 4 bits of a little-endian word is its first byte's */
+        unsigned char *words = memchr(image, '\n', len);
+        assert(words != NULL);
+        words = memchr(words + 1, '\n', len - (words + 1 - image));
+        assert(words != NULL);
+        words++;
+        size_t at = (words - image) + (len - (words - image)) / 2 / 4 * 4;
+        unsigned char *bad = malloc(len);
+        assert(bad != NULL);
+        memcpy(bad, image, len);
+        bad[at] |= 0x0f;
+
+        unsigned char *reply;
+        size_t reply_len;
+        for (int k = 0; k < 2; k++) {
+                send_request(fd, 'd', bad, len);
+                assert(get_reply(fd, &reply, &reply_len) == 1);
+                free(reply);
+        }
+        check_bad_headers(fd);
+        send_request(fd, 'd', image, len);
+        assert(get_reply(fd, &reply, &reply_len) == 0);
+        assert(reply_len > 2 && memcmp(reply, "P6", 2) == 0);
+        assert(waitpid(server, NULL, WNOHANG) == 0);
+
+        free(reply);
+        free(bad);
+        free(image);
+        free(ppm);
+        close(fd);
+        kill(server, SIGTERM);
+        waitpid(server, NULL, 0);
+        unlink(path);
+}
+
+/* sends payloads that are malformed before any word or pixel is coded, 
+   and expects an error reply to each */
+static void check_bad_headers(int fd)
+{
+        static const char *const bad[][2] = {
+                /* the blocks across, (w + 1) / 2, wrap to 0 */
+                { "d", "COMP40 Compressed image format 3\n4294967295 1\n" },
+                /* twice the words across is past INT_MAX */
+                { "d", "COMP40 Compressed image format 2\n2147483647 1\n" },
+                /* sizes in range, with no words */
+                { "d", "COMP40 Compressed image format 3\n"
+                       "2147483647 2147483647\n" },
+                /* half the width, rounded up, would wrap to a 0-byte row */
+                { "c", "P3\n4294967295 1\n255\n1 2 3 4 5 6 7 8 9\n" },
+                /* a width in range, far too wide for the samples sent */
+                { "c", "P3\n2147483647 1\n255\n1 2 3 4 5 6\n" },
+                { "c", "P6\n2147483647 2147483647\n255\n\1\2\3\4\5\6" },
+                /* a sample over maxval */
+                { "c", "P3\n2 2\n255\n70000 0 0 0 0 0 0 0 0 0 0 0\n" },
+        };
+        for (size_t k = 0; k < sizeof(bad) / sizeof(bad[0]); k++) {
+                unsigned char *reply;
+                size_t reply_len;
+                send_request(fd, bad[k][0][0], 
+                             (const unsigned char *)bad[k][1], 
+                             strlen(bad[k][1]));
+                assert(get_reply(fd, &reply, &reply_len) == 1);
+                free(reply);
+        }
+}
+
+/* connects to the socket at path, waiting for the server to make it */
+static int connect_to(const char *path)
+{
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        assert(strlen(path) < sizeof(addr.sun_path));
+        strcpy(addr.sun_path, path);
+
+        struct timespec wait = { 0, 50 * 1000 * 1000 };
+        for (int tries = 0; tries < 100; tries++) {
+                int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+                assert(fd >= 0);
+                if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+                        return fd;
+                }
+                close(fd);
+                nanosleep(&wait, NULL);
+        }
+        assert(0);
+        return -1;
+}
+
+/* sends an opcode, the length most significant byte first, and the bytes */
+static void send_request(int fd, unsigned char op, const unsigned char *bytes,
+                                                                   size_t len)
+{
+        unsigned char header[5] = { op, len >> 24, len >> 16, len >> 8, len };
+        assert(write(fd, header, sizeof(header)) == (ssize_t)sizeof(header));
+        for (size_t sent = 0; sent < len; ) {
+                ssize_t n = write(fd, bytes + sent, len - sent);
+                assert(n > 0);
+                sent += n;
+        }
+}
+
+/* reads a reply into a new buffer and returns its status */
+static unsigned char get_reply(int fd, unsigned char **bytes, size_t *len)
+{
+        unsigned char header[5];
+        read_all(fd, header, sizeof(header));
+        *len = (size_t)header[1] << 24 | (size_t)header[2] << 16
+               | (size_t)header[3] << 8 | header[4];
+        *bytes = malloc(*len + 1);
+        assert(*bytes != NULL);
+        read_all(fd, *bytes, *len);
+        return header[0];
+}
+
+static void read_all(int fd, void *bytes, size_t len)
+{
+        for (size_t got = 0; got < len; ) {
+                ssize_t n = read(fd, (unsigned char *)bytes + got, len - got);
+                assert(n > 0);
+                got += n;
+        }
+}
+
+/* a TEST_SIDE x TEST_SIDE PPM of a smooth gradient */
+static unsigned char *make_ppm(size_t *len)
+{
+        char header[64];
+        int n = snprintf(header, sizeof(header), "P6\n%u %u\n255\n",
+                                                    TEST_SIDE, TEST_SIDE);
+        *len = n + 3 * (size_t)TEST_SIDE * TEST_SIDE;
+        unsigned char *ppm = malloc(*len);
+        assert(ppm != NULL);
+        memcpy(ppm, header, n);
+
+        unsigned char *p = ppm + n;
+        for (unsigned j = 0; j < TEST_SIDE; j++) {
+                for (unsigned i = 0; i < TEST_SIDE; i++) {
+                        *p++ = i / 2;
+                        *p++ = j / 2;
+                        *p++ = (i + j) / 4;
+                }
+        }
+        return ppm;
+}
@@ -0,0 +1,573 @@
+/* Filename:         simd.c
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      SIMD is a module with vector versions of the per-block 
+ *                   kernels in RGBCONVERT and PACKPIX, which work on 
+ *                   SIMD_LANES blocks at once with AVX2. They are compiled 
+ *                   for AVX2 whatever the rest of the program is compiled 
+ *                   for, so callers must check simd_available() first and 
+ *                   fall back to the scalar kernels if it is false.
+ * 
+ *                   Each kernel does the same floating point operations in 
+ *                   the same order as its scalar version, so the results are
+ *                   bit-for-bit the same: color conversion is done in double
+ *                   and rounded to float, just like assigning to a 
+ *                   struct comp_vid does.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "assert.h"
+#include "simd.h"
+#include "rgbconvert.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_AVX2_KERNELS 1
+#include <immintrin.h>
+#else
+#define HAVE_AVX2_KERNELS 0
+#endif
+
+
+#if HAVE_AVX2_KERNELS
+static pthread_once_t avx2_once = PTHREAD_ONCE_INIT;
+static bool avx2;
+
+/* looks the answer up, once for all threads */
+static void check_avx2(void)
+{
+        __builtin_cpu_init();
+        avx2 = __builtin_cpu_supports("avx2") != 0;
+}
+#endif
+
+
+/* Description: Checks whether this CPU can run the vector kernels. The 
+ *              answer is looked up once and remembered; worker threads may
+ *              all ask at the same time.
+ *              
+ * Input:       None.
+ * Output:      True if the vector kernels can be called. 
+ */
+bool simd_available(void)
+{
+#if HAVE_AVX2_KERNELS
+        pthread_once(&avx2_once, check_avx2);
+        return avx2;
+#else
+        return false;
+#endif
+}
+
+
+#if HAVE_AVX2_KERNELS
+
+#define AVX2 __attribute__((target("avx2")))
+
+/* component video of one pixel of each of SIMD_LANES blocks */
+struct cv_lanes {
+        __m256 lum, pb, pr;
+};
+
+/* the samples of 8 consecutive pixels, split by channel: blends put each
+ * pixel's sample of a channel in a lane of its own, and a permute puts the
+ * even pixels in the low half, in order, and the odd ones in the high half
+ */
+AVX2 static inline void split_channels(const struct Pnm_rgb *pixels, 
+                                       __m256i rgb[3])
+{
+        const __m256i *p = (const __m256i *)pixels;
+        __m256i v0 = _mm256_loadu_si256(p);
+        __m256i v1 = _mm256_loadu_si256(p + 1);
+        __m256i v2 = _mm256_loadu_si256(p + 2);
+
+        __m256i r = _mm256_blend_epi32(_mm256_blend_epi32(v0, v1, 0x92), 
+                                       v2, 0x24);
+        __m256i g = _mm256_blend_epi32(_mm256_blend_epi32(v0, v1, 0x24), 
+                                       v2, 0x49);
+        __m256i b = _mm256_blend_epi32(_mm256_blend_epi32(v0, v1, 0x49), 
+                                       v2, 0x92);
+        rgb[0] = _mm256_permutevar8x32_epi32(r, 
+                        _mm256_setr_epi32(0, 6, 4, 2, 3, 1, 7, 5));
+        rgb[1] = _mm256_permutevar8x32_epi32(g, 
+                        _mm256_setr_epi32(1, 7, 5, 3, 4, 2, 0, 6));
+        rgb[2] = _mm256_permutevar8x32_epi32(b, 
+                        _mm256_setr_epi32(2, 0, 6, 4, 5, 3, 1, 7));
+}
+
+
+/* the channels of 2 * SIMD_LANES pixels of a scanline, structure of 
+ * arrays: the even pixels, each the left of a block, in even[], and the 
+ * odd ones in odd[], one block per lane 
+ */
+AVX2 static inline void load_lanes(const struct Pnm_rgb *pixels, 
+                                   __m256i even[3], __m256i odd[3])
+{
+        __m256i lo[3], hi[3];
+        split_channels(pixels, lo);
+        split_channels(pixels + SIMD_LANES, hi);
+        for (int k = 0; k < 3; k++) {
+                even[k] = _mm256_permute2x128_si256(lo[k], hi[k], 0x20);
+                odd[k] = _mm256_permute2x128_si256(lo[k], hi[k], 0x31);
+        }
+}
+
+/* rounds the lane's two halves of doubles to float and divides by denom */
+AVX2 static inline __m256 to_float(__m256d lo, __m256d hi, __m256 denom)
+{
+        __m256 f = _mm256_castps128_ps256(_mm256_cvtpd_ps(lo));
+        f = _mm256_insertf128_ps(f, _mm256_cvtpd_ps(hi), 1);
+        return _mm256_div_ps(f, denom);
+}
+
+/* one of the three sums of rgb_pix_to_cv on four lanes of doubles. The 
+ * scalar code subtracts some terms; since negation is exact, adding the 
+ * product with a negated coefficient gives the same bits.
+ */
+AVX2 static inline __m256d weigh(__m256d r, __m256d g, __m256d b, 
+                                 double kr, double kg, double kb)
+{
+        __m256d sum = _mm256_mul_pd(_mm256_set1_pd(kr), r);
+        sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(kg), g));
+        return _mm256_add_pd(sum, _mm256_mul_pd(_mm256_set1_pd(kb), b));
+}
+
+/* rgb_pix_to_cv for one pixel per lane, from lanes of its red, green and
+ * blue samples 
+ */
+AVX2 static inline struct cv_lanes pix_to_cv(const __m256i in[3], 
+                                             __m256 denom)
+{
+        struct cv_lanes cv;
+
+        /* each half of the lanes in double, as the scalar code does */
+        __m256d lo[3], hi[3];
+        for (int k = 0; k < 3; k++) {
+                lo[k] = _mm256_cvtepi32_pd(_mm256_castsi256_si128(in[k]));
+                hi[k] = _mm256_cvtepi32_pd(_mm256_extracti128_si256(in[k], 
+                                                                         1));
+        }
+
+        cv.lum = to_float(weigh(lo[0], lo[1], lo[2], 0.299, 0.587, 0.114),
+                          weigh(hi[0], hi[1], hi[2], 0.299, 0.587, 0.114), 
+                                                                      denom);
+
+        cv.pb = to_float(weigh(lo[0], lo[1], lo[2], -0.168736, -0.331264, 0.5),
+                         weigh(hi[0], hi[1], hi[2], -0.168736, -0.331264, 0.5),
+                                                                      denom);
+        cv.pr = to_float(weigh(lo[0], lo[1], lo[2], 0.5, -0.418688, -0.081312),
+                         weigh(hi[0], hi[1], hi[2], 0.5, -0.418688, -0.081312),
+                                                                      denom);
+        return cv;
+}
+
+AVX2 static inline __m256 clip(__m256 x, float lo, float hi)
+{
+        return _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(lo)), 
+                                                        _mm256_set1_ps(hi));
+}
+
+
+/* Description: Vector version of rgb_block_to_word up to quantization: does
+ *              the component video conversion and cosine transform of 
+ *              SIMD_LANES side-by-side blocks. Must only be called if 
+ *              simd_available().
+ *              
+ * Input:       Top and bottom scanlines of at least 2 * SIMD_LANES pixels,
+ *              denominator of the pixmap, and the lanes to fill in.
+ * Output:      None. The clipped block averages are written to fcv.
+ */
+AVX2 void simd_rgb_blocks_to_float(const struct Pnm_rgb *top, 
+                                   const struct Pnm_rgb *bottom, int denom,
+                                   struct float_comp_vid_lanes *fcv)
+{
+        assert(top != NULL && bottom != NULL && fcv != NULL);
+        __m256 fdenom = _mm256_set1_ps((float)denom);
+        __m256 four = _mm256_set1_ps(4.0f);
+
+        __m256i top_left[3], top_right[3], bottom_left[3], bottom_right[3];
+        load_lanes(top, top_left, top_right);
+        load_lanes(bottom, bottom_left, bottom_right);
+
+        /* same cell order as a block of a UArray2b with blocksize 2 */
+        struct cv_lanes cv[4];
+        cv[0] = pix_to_cv(top_left, fdenom);
+        cv[1] = pix_to_cv(bottom_left, fdenom);
+        cv[2] = pix_to_cv(top_right, fdenom);
+        cv[3] = pix_to_cv(bottom_right, fdenom);
+
+        __m256 y1 = cv[0].lum, y2 = cv[1].lum, y3 = cv[2].lum, y4 = cv[3].lum;
+        __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(y1, y2), y3), y4);
+        __m256 b = _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(y4, y3), y2), y1);
+        __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(y4, y3), y2), y1);
+        __m256 d = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(y4, y3), y2), y1);
+
+        __m256 total_pb = _mm256_setzero_ps();
+        __m256 total_pr = _mm256_setzero_ps();
+        for (int k = 0; k < 4; k++) {
+                total_pb = _mm256_add_ps(total_pb, cv[k].pb);
+                total_pr = _mm256_add_ps(total_pr, cv[k].pr);
+        }
+
+        /* the bounds of clip_float_cv in packpix.c */
+        _mm256_storeu_ps(fcv->a, _mm256_div_ps(a, four));
+        _mm256_storeu_ps(fcv->b, clip(_mm256_div_ps(b, four), -0.3f, 0.3f));
+        _mm256_storeu_ps(fcv->c, clip(_mm256_div_ps(c, four), -0.3f, 0.3f));
+        _mm256_storeu_ps(fcv->d, clip(_mm256_div_ps(d, four), -0.3f, 0.3f));
+        _mm256_storeu_ps(fcv->pb_avg, 
+                         clip(_mm256_div_ps(total_pb, four), -0.5f, 0.5f));
+        _mm256_storeu_ps(fcv->pr_avg, 
+                         clip(_mm256_div_ps(total_pr, four), -0.5f, 0.5f));
+}
+
+
+/* a coefficient quantized as luma_to_quant in packpix.c does: scaled by its
+ * QUANT_FACTOR, truncated, and clamped to the bounds of clip_quant 
+ */
+AVX2 static inline __m256i quantize(__m256 x)
+{
+        __m256i q = _mm256_cvttps_epi32(_mm256_mul_ps(x, 
+                                                      _mm256_set1_ps(64.0f)));
+        return _mm256_min_epi32(_mm256_max_epi32(q, _mm256_set1_epi32(-15)),
+                                                     _mm256_set1_epi32(15));
+}
+
+
+/* the count of bounds[1..levels - 1] at or below each lane of x, which is
+ * what chroma_to_level in packpix.c gives: each compare is all ones, -1, 
+ * where a bound is met
+ */
+AVX2 static inline __m256i count_bounds(__m256 x, const float bounds[], 
+                                        int levels)
+{
+        __m256i level = _mm256_setzero_si256();
+        for (int q = 1; q < levels; q++) {
+                __m256 met = _mm256_cmp_ps(x, _mm256_set1_ps(bounds[q]), 
+                                                                  _CMP_GE_OQ);
+                level = _mm256_sub_epi32(level, _mm256_castps_si256(met));
+        }
+        return level;
+}
+
+
+/* Description: Vector version of float_to_quant in packpix.c: quantizes the
+ *              block averages of SIMD_LANES blocks. Must only be called if 
+ *              simd_available().
+ *              
+ * Input:       Lanes of clipped block averages, the lowest chroma of each 
+ *              of levels chroma levels, and six arrays of at least 
+ *              SIMD_LANES to fill in with a, b, c, d and the two chroma 
+ *              levels, in that order.
+ * Output:      None. The quantized values are written to quant.
+ */
+AVX2 void simd_quantize_blocks(const struct float_comp_vid_lanes *fcv, 
+                               const float bounds[], int levels, 
+                               int32_t *quant[6])
+{
+        assert(fcv != NULL && bounds != NULL && quant != NULL);
+
+        /* a is stored in 6 unsigned bits, so it keeps its value mod 64 */
+        __m256i a = _mm256_cvttps_epi32(_mm256_mul_ps(
+                        _mm256_loadu_ps(fcv->a), _mm256_set1_ps(64.0f)));
+        a = _mm256_and_si256(a, _mm256_set1_epi32(63));
+
+        _mm256_storeu_si256((__m256i *)quant[0], a);
+        _mm256_storeu_si256((__m256i *)quant[1], 
+                            quantize(_mm256_loadu_ps(fcv->b)));
+        _mm256_storeu_si256((__m256i *)quant[2], 
+                            quantize(_mm256_loadu_ps(fcv->c)));
+        _mm256_storeu_si256((__m256i *)quant[3], 
+                            quantize(_mm256_loadu_ps(fcv->d)));
+        _mm256_storeu_si256((__m256i *)quant[4], 
+                count_bounds(_mm256_loadu_ps(fcv->pb_avg), bounds, levels));
+        _mm256_storeu_si256((__m256i *)quant[5], 
+                count_bounds(_mm256_loadu_ps(fcv->pr_avg), bounds, levels));
+}
+
+
+/* cv_pix_to_rgb for one pixel of each block, to denominator denom: the 
+ * three sums are done in double and truncated, as assigning to a signed 
+ * does. Leaves each channel's samples in two halves of four 32-bit lanes, 
+ * unclipped, for the caller to pack with saturation.
+ */
+AVX2 static inline void cv_to_samples(__m256 lum, __m256 pb, __m256 pr, 
+                                      int denom, __m128i samples[3][2])
+{
+        __m256 scale = _mm256_set1_ps((float)denom);
+        lum = _mm256_mul_ps(lum, scale);
+        pb = _mm256_mul_ps(pb, scale);
+        pr = _mm256_mul_ps(pr, scale);
+
+        __m256d l[2], b[2], r[2];
+        l[0] = _mm256_cvtps_pd(_mm256_castps256_ps128(lum));
+        l[1] = _mm256_cvtps_pd(_mm256_extractf128_ps(lum, 1));
+        b[0] = _mm256_cvtps_pd(_mm256_castps256_ps128(pb));
+        b[1] = _mm256_cvtps_pd(_mm256_extractf128_ps(pb, 1));
+        r[0] = _mm256_cvtps_pd(_mm256_castps256_ps128(pr));
+        r[1] = _mm256_cvtps_pd(_mm256_extractf128_ps(pr, 1));
+
+        for (int h = 0; h < 2; h++) {
+                __m256d sum;
+                sum = _mm256_add_pd(l[h], 
+                        _mm256_mul_pd(_mm256_set1_pd(1.402), r[h]));
+                samples[0][h] = _mm256_cvttpd_epi32(sum);
+
+                sum = _mm256_sub_pd(l[h], 
+                        _mm256_mul_pd(_mm256_set1_pd(0.344136), b[h]));
+                sum = _mm256_sub_pd(sum, 
+                        _mm256_mul_pd(_mm256_set1_pd(0.714136), r[h]));
+                samples[1][h] = _mm256_cvttpd_epi32(sum);
+
+                sum = _mm256_add_pd(l[h], 
+                        _mm256_mul_pd(_mm256_set1_pd(1.772), b[h]));
+                samples[2][h] = _mm256_cvttpd_epi32(sum);
+        }
+}
+
+
+/* cv_to_samples to denominator RGB_DENOM, leaving the 8 bytes of each 
+ * channel in the low halves of rgb[0..2]
+ */
+AVX2 static inline void cv_to_rgb(__m256 lum, __m256 pb, __m256 pr, 
+                                  __m128i rgb[3])
+{
+        __m128i s[3][2];
+        cv_to_samples(lum, pb, pr, RGB_DENOM, s);
+
+        /* 32 -> 16 bits keeps the sign, 16 -> 8 saturates to [0, 255] */
+        __m128i zero = _mm_setzero_si128();
+        for (int ch = 0; ch < 3; ch++) {
+                rgb[ch] = _mm_packus_epi16(_mm_packs_epi32(s[ch][0], 
+                                                           s[ch][1]), zero);
+        }
+}
+
+
+/* cv_to_samples to denominator RGB16_DENOM, leaving the 8 16-bit samples of
+ * each channel in rgb[0..2]; 32 -> 16 bits with unsigned saturation does 
+ * both clips
+ */
+AVX2 static inline void cv_to_rgb16(__m256 lum, __m256 pb, __m256 pr, 
+                                    __m128i rgb[3])
+{
+        __m128i s[3][2];
+        cv_to_samples(lum, pb, pr, RGB16_DENOM, s);
+
+        for (int ch = 0; ch < 3; ch++) {
+                rgb[ch] = _mm_packus_epi32(s[ch][0], s[ch][1]);
+        }
+}
+
+
+/* the inverse cosine transform of SIMD_LANES blocks from their dequantized
+ * averages, clipped with the bounds of clip_float_cv and clip_cv in 
+ * packpix.c: the luma of each cell, in the same cell order as a block of a 
+ * UArray2b with blocksize 2, and the chroma they share
+ */
+AVX2 static inline void float_to_cv(const struct float_comp_vid_lanes *fcv,
+                                    __m256 lum[4], __m256 *pb, __m256 *pr)
+{
+        __m256 a = _mm256_loadu_ps(fcv->a);
+        __m256 b = clip(_mm256_loadu_ps(fcv->b), -0.3f, 0.3f);
+        __m256 c = clip(_mm256_loadu_ps(fcv->c), -0.3f, 0.3f);
+        __m256 d = clip(_mm256_loadu_ps(fcv->d), -0.3f, 0.3f);
+        *pb = clip(_mm256_loadu_ps(fcv->pb_avg), -0.5f, 0.5f);
+        *pr = clip(_mm256_loadu_ps(fcv->pr_avg), -0.5f, 0.5f);
+
+        lum[0] = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(a, b), c), d);
+        lum[1] = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(a, b), c), d);
+        lum[2] = _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(a, b), c), d);
+        lum[3] = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(a, b), c), d);
+        for (int k = 0; k < 4; k++) {
+                lum[k] = clip(lum[k], 0.0f, 1.0f);
+        }
+}
+
+
+/* Description: Vector version of word_to_rgb_block from dequantization on: 
+ *              does the inverse cosine transform and RGB conversion of 
+ *              SIMD_LANES side-by-side blocks and stores the saturated 
+ *              bytes. Must only be called if simd_available().
+ *              
+ * Input:       Lanes of dequantized block averages, and top and bottom 
+ *              scanline buffers with room for 2 * SIMD_LANES pixels of 3
+ *              bytes each.
+ * Output:      None. The RGB bytes are written to the scanlines.
+ */
+AVX2 void simd_float_to_rgb_blocks(const struct float_comp_vid_lanes *fcv,
+                                   unsigned char *top, unsigned char *bottom)
+{
+        assert(fcv != NULL && top != NULL && bottom != NULL);
+
+        __m256 lum[4], pb, pr;
+        float_to_cv(fcv, lum, &pb, &pr);
+
+        unsigned char bytes[4][3][16];
+        for (int k = 0; k < 4; k++) {
+                __m128i rgb[3];
+                cv_to_rgb(lum[k], pb, pr, rgb);
+                for (int ch = 0; ch < 3; ch++)
+                        _mm_storeu_si128((__m128i *)bytes[k][ch], rgb[ch]);
+        }
+
+        /* interleave the channels; cells 0 and 2 are on top, 1 and 3 below */
+        for (int lane = 0; lane < SIMD_LANES; lane++) {
+                for (int ch = 0; ch < 3; ch++) {
+                        top[6 * lane + ch]        = bytes[0][ch][lane];
+                        top[6 * lane + 3 + ch]    = bytes[2][ch][lane];
+                        bottom[6 * lane + ch]     = bytes[1][ch][lane];
+                        bottom[6 * lane + 3 + ch] = bytes[3][ch][lane];
+                }
+        }
+}
+
+
+/* stores one big-endian 16-bit sample */
+static inline void put_sample16(unsigned char *at, uint16_t sample)
+{
+        at[0] = (unsigned char)(sample >> 8);
+        at[1] = (unsigned char)sample;
+}
+
+
+/* Description: simd_float_to_rgb_blocks to 16-bit samples: does the inverse
+ *              cosine transform and RGB conversion of SIMD_LANES 
+ *              side-by-side blocks to denominator RGB16_DENOM and stores the
+ *              saturated samples big-endian, as in a P6 with maxval 65535.
+ *              Must only be called if simd_available().
+ *              
+ * Input:       Lanes of dequantized block averages, and top and bottom 
+ *              scanline buffers with room for 2 * SIMD_LANES pixels of 6
+ *              bytes each.
+ * Output:      None. The RGB samples are written to the scanlines.
+ */
+AVX2 void simd_float_to_rgb16_blocks(const struct float_comp_vid_lanes *fcv,
+                                     unsigned char *top, 
+                                     unsigned char *bottom)
+{
+        assert(fcv != NULL && top != NULL && bottom != NULL);
+
+        __m256 lum[4], pb, pr;
+        float_to_cv(fcv, lum, &pb, &pr);
+
+        uint16_t samples[4][3][SIMD_LANES];
+        for (int k = 0; k < 4; k++) {
+                __m128i rgb[3];
+                cv_to_rgb16(lum[k], pb, pr, rgb);
+                for (int ch = 0; ch < 3; ch++)
+                        _mm_storeu_si128((__m128i *)samples[k][ch], rgb[ch]);
+        }
+
+        /* cells 0 and 2 are on top, 1 and 3 below, 2 bytes per sample */
+        for (int lane = 0; lane < SIMD_LANES; lane++) {
+                for (int ch = 0; ch < 3; ch++) {
+                        put_sample16(top + 12 * lane + 2 * ch, 
+                                     samples[0][ch][lane]);
+                        put_sample16(top + 12 * lane + 6 + 2 * ch, 
+                                     samples[2][ch][lane]);
+                        put_sample16(bottom + 12 * lane + 2 * ch, 
+                                     samples[1][ch][lane]);
+                        put_sample16(bottom + 12 * lane + 6 + 2 * ch, 
+                                     samples[3][ch][lane]);
+                }
+        }
+}
+
+
+/* Description: Unpacks the raw samples of n pixels of a P6 row, 8 at a 
+ *              time: widens 1-byte samples, or byte-swaps and widens 
+ *              big-endian 2-byte ones. Each group of 8 samples is loaded 
+ *              before it is stored, so the raw bytes may sit in the tail of
+ *              the pixels' own memory, as read_ppm_row puts them. Must only
+ *              be called if simd_available().
+ *              
+ * Input:       The raw samples, the number of pixels n (a multiple of 
+ *              SIMD_LANES), whether the samples are 2 bytes wide, and the 
+ *              pixels to unpack them into.
+ * Output:      None. The pixels are written.
+ */
+AVX2 void simd_unpack_pixels(const unsigned char *bytes, unsigned n, 
+                             bool wide, struct Pnm_rgb *pixels)
+{
+        assert(bytes != NULL && pixels != NULL);
+        assert(n % SIMD_LANES == 0);
+        assert(sizeof(struct Pnm_rgb) == 3 * sizeof(uint32_t));
+
+        /* swaps the two bytes of every 16-bit lane */
+        const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 
+                                           9, 8, 11, 10, 13, 12, 15, 14);
+        unsigned char *out = (unsigned char *)pixels;
+
+        for (unsigned k = 0; k < 3 * n; k += SIMD_LANES) {
+                __m256i samples;
+                if (wide) {
+                        __m128i raw = _mm_loadu_si128(
+                                        (const __m128i *)(bytes + 2 * k));
+                        samples = _mm256_cvtepu16_epi32(
+                                        _mm_shuffle_epi8(raw, swap));
+                } else {
+                        __m128i raw = _mm_loadl_epi64(
+                                        (const __m128i *)(bytes + k));
+                        samples = _mm256_cvtepu8_epi32(raw);
+                }
+                _mm256_storeu_si256((__m256i *)(out + 4 * k), samples);
+        }
+}
+
+#else
+
+void simd_rgb_blocks_to_float(const struct Pnm_rgb *top, 
+                              const struct Pnm_rgb *bottom, int denom,
+                              struct float_comp_vid_lanes *fcv)
+{
+        (void)top;
+        (void)bottom;
+        (void)denom;
+        (void)fcv;
+        assert(0);
+}
+
+void simd_quantize_blocks(const struct float_comp_vid_lanes *fcv, 
+                          const float bounds[], int levels, int32_t *quant[6])
+{
+        (void)fcv;
+        (void)bounds;
+        (void)levels;
+        (void)quant;
+        assert(0);
+}
+
+void simd_float_to_rgb_blocks(const struct float_comp_vid_lanes *fcv,
+                              unsigned char *top, unsigned char *bottom)
+{
+        (void)fcv;
+        (void)top;
+        (void)bottom;
+        assert(0);
+}
+
+void simd_float_to_rgb16_blocks(const struct float_comp_vid_lanes *fcv,
+                                unsigned char *top, unsigned char *bottom)
+{
+        (void)fcv;
+        (void)top;
+        (void)bottom;
+        assert(0);
+}
+
+void simd_unpack_pixels(const unsigned char *bytes, unsigned n, bool wide,
+                        struct Pnm_rgb *pixels)
+{
+        (void)bytes;
+        (void)n;
+        (void)wide;
+        (void)pixels;
+        assert(0);
+}
+
+#endif
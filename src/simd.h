@@ -0,0 +1,39 @@
+/* Filename:         simd.h
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      Header file for SIMD module. 
+ */
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "pnm.h"
+#include "types.h"
+
+extern bool simd_available(void);
+
+extern void simd_rgb_blocks_to_float(const struct Pnm_rgb *top, 
+                                     const struct Pnm_rgb *bottom, int denom,
+                                     struct float_comp_vid_lanes *fcv);
+
+extern void simd_quantize_blocks(const struct float_comp_vid_lanes *fcv, 
+                                 const float bounds[], int levels, 
+                                 int32_t *quant[6]);
+
+extern void simd_float_to_rgb_blocks(const struct float_comp_vid_lanes *fcv,
+                                     unsigned char *top, 
+                                     unsigned char *bottom);
+
+extern void simd_float_to_rgb16_blocks(const struct float_comp_vid_lanes *fcv,
+                                       unsigned char *top, 
+                                       unsigned char *bottom);
+
+extern void simd_unpack_pixels(const unsigned char *bytes, unsigned n, 
+                               bool wide, struct Pnm_rgb *pixels);
+
+#endif
@@ -11,12 +11,14 @@
 #define TYPES_H
 
 #include "uarray.h"
+#include "uarray2.h"
 
 struct UArray2b_T { 
         int width, height;
         unsigned blocksize;
         unsigned size;
-        UArray2_T blocks;
+        int xblocks, yblocks;
+        char *cells;
 };
 
 /* comp_vid contains data about an individual pixel */
@@ -41,6 +43,21 @@ struct float_comp_vid
         float pr_avg;
 };
 
+/* float_comp_vids of SIMD_LANES blocks side by side, one array per member,
+ * so that the vector kernels can load and store whole lanes
+ */
+#define SIMD_LANES 8
+
+struct float_comp_vid_lanes
+{
+        float a[SIMD_LANES];
+        float b[SIMD_LANES];
+        float c[SIMD_LANES];
+        float d[SIMD_LANES];
+        float pb_avg[SIMD_LANES];
+        float pr_avg[SIMD_LANES];
+};
+
 /* defines quantized bit fields for component video block */
 struct quant_comp_vid
 {
@@ -57,7 +74,8 @@ struct quant_comp_vid
 struct UArray2_T {
         int width, height;
         int size;
-        UArray_T rows;
+        size_t stride;
+        char *elems;
 };
 
 #endif
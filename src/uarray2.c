@@ -1,7 +1,7 @@
-#line 50 "www/solutions/uarray2.nw"
+#include <stddef.h>
+#include <stdlib.h>
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
 #include "uarray2.h"
 
 #define T UArray2_T
@@ -9,62 +9,70 @@
 struct T {
         int width, height;
         int size;
-        UArray_T rows; /* UArray_T of 'height' UArray_Ts,
-                          each of length 'width' and size 'size' */
+        size_t stride;  /* bytes from the start of one row to the next */
+        char *elems;    /* one allocation of 'height' rows, each 'width'
+                           elements of size 'size' */
         // Element (i, j) in the world of ideas maps to
-        //   rows[j][i] where the square brackets stand for access
-        //   to a Hanson UArray_T
+        //   elems + j * stride + i * size
 };
-#line 77 "www/solutions/uarray2.nw"
-static inline UArray_T row(T a, int j)
+
+static inline char *row(T a, int j)
 {
-        UArray_T *prow = UArray_at(a->rows, j); // Ramsey idiom
-        return *prow;
+        return a->elems + (size_t)j * a->stride;
 }
-#line 90 "www/solutions/uarray2.nw"
+
 static int is_ok(T a)
 {
-        return a && UArray_length(a->rows) == a->height &&
-               UArray_size(a->rows) == sizeof(UArray_T) &&
-               (a->height == 0 || (UArray_length(row(a, 0)) == a->width
-                                   && UArray_size  (row(a, 0)) == a->size));
+        return a && a->width >= 0 && a->height >= 0 && a->size > 0 &&
+               a->stride == (size_t)a->width * a->size &&
+               (a->elems != NULL || a->stride * a->height == 0);
 }
-#line 107 "www/solutions/uarray2.nw"
+
 T UArray2_new(int width, int height, int size)
 {
-        int i;  /* interates over row number */
         T array;
         NEW(array);
         array->width  = width;
         array->height = height;
         array->size   = size;
-        array->rows   = UArray_new(height, sizeof(UArray_T));
-        for (i = 0; i < height; i++) {
-                UArray_T *rowp = UArray_at(array->rows, i);
-                *rowp = UArray_new(width, size);
-        }
+        array->stride = (size_t)width * size;
+
+        /* one zeroed allocation for every row, instead of a UArray_T 
+           per row and one to hold them */
+        size_t nelems = (size_t)width * height;
+        array->elems = nelems == 0 ? NULL : CALLOC(nelems, size);
         assert(is_ok(array));
         return array;
 }
-#line 129 "www/solutions/uarray2.nw"
+
 void UArray2_free(T *array2)
 {
-        int i;
         assert(array2 && *array2);
-        for (i = 0; i < (*array2)->height; i++) {
-                UArray_T p = row(*array2, i);
-                UArray_free(&p);
-        }
-        UArray_free(&(*array2)->rows);
+        FREE((*array2)->elems);
         FREE(*array2);
 }
-#line 149 "www/solutions/uarray2.nw"
+
 void *UArray2_at(T array2, int i, int j)
 {
         assert(array2);
-        return UArray_at(row(array2, j), i);
+        assert(i >= 0 && i < array2->width);
+        assert(j >= 0 && j < array2->height);
+        return row(array2, j) + (size_t)i * array2->size;
 }
-#line 160 "www/solutions/uarray2.nw"
+
+void *UArray2_row_ptr(T array2, int j)
+{
+        assert(array2);
+        assert(j >= 0 && j < array2->height);
+        return row(array2, j);
+}
+
+size_t UArray2_stride(T array2)
+{
+        assert(array2);
+        return array2->stride;
+}
+
 int UArray2_height(T array2)
 {
         assert(array2);
@@ -82,7 +90,6 @@ int UArray2_size(T array2)
         assert(array2);
         return array2->size;
 }
-#line 191 "www/solutions/uarray2.nw"
 
 
 void UArray2_map_row_major(T array2, 
@@ -93,16 +100,16 @@ void UArray2_map_row_major(T array2,
         assert(array2);
         int h = array2->height;  // keeping height and width in registers 
         int w = array2->width;   // avoids extra memory traffic
+        int size = array2->size;
         for (int j = 0; j < h; j++) {
-                // don't want row/UArray_at in inner loop
-                UArray_T thisrow = row(array2, j); 
-                for (int i = 0; i < w; i++)
-                        apply(i, j, array2, UArray_at(thisrow, i), cl);
+                // don't want row/UArray2_at in inner loop
+                char *elem = row(array2, j); 
+                for (int i = 0; i < w; i++, elem += size)
+                        apply(i, j, array2, elem, cl);
         }
 }
 
 
-#line 209 "www/solutions/uarray2.nw"
 void UArray2_map_col_major(T array2, 
                            void apply(int i, int j, T array2, 
                                       void *elem, void *cl), 
@@ -113,5 +120,6 @@ void UArray2_map_col_major(T array2,
         int w = array2->width;   // avoids extra memory traffic
         for (int i = 0; i < w; i++)
                 for (int j = 0; j < h; j++)
-                        apply(i, j, array2, UArray_at(row(array2, j), i), cl);
+                        apply(i, j, array2, 
+                              row(array2, j) + (size_t)i * array2->size, cl);
 }
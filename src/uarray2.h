@@ -1,5 +1,7 @@
 #ifndef ARRAY2_INCLUDED
 #define ARRAY2_INCLUDED
+#include <stddef.h>
+
 #define T UArray2_T
 typedef struct T *T;
 
@@ -12,8 +14,27 @@ extern int   UArray2_width (T array2);
 extern int   UArray2_height(T array2);
 extern int   UArray2_size  (T array2);
 extern void *UArray2_at    (T array2, int i, int j);
+extern void *UArray2_row_ptr(T array2, int j);
+  /* the elements of row j are contiguous, starting here */
+extern size_t UArray2_stride(T array2);
+  /* bytes from the start of one row to the start of the next */
 extern void  UArray2_map_row_major(T array2, void apply(), void *cl);
 extern void  UArray2_map_col_major(T array2, void apply(), void *cl);
+
+/* Visits the rows in order without a callback, binding j to the row index
+   and row to a pointer of the given element type to its first element,
+   so the body can be a plain loop over row[0 .. width - 1]:
+
+        UArray2_FOR_EACH_ROW(array2, j, struct Pnm_rgb, row) {
+                for (int i = 0; i < UArray2_width(array2); i++)
+                        ... row[i] is element (i, j)
+        }
+
+   break leaves only the current row. */
+#define UArray2_FOR_EACH_ROW(array2, j, type, row)                       \
+        for (int j = 0; j < UArray2_height(array2); j++)                 \
+                for (type *row = UArray2_row_ptr(array2, j); row != NULL; \
+                     row = NULL)
 #undef T
 
 #endif
@@ -1,5 +1,6 @@
 #ifndef UARRAY2B_INCLUDED
 #define UARRAY2B_INCLUDED
+#include <stddef.h>
 
 #define T UArray2b_T
 typedef struct T *T;
@@ -22,10 +23,83 @@ extern void *UArray2b_at(T array2b, int i, int j);
      index out of range is a checked run-time error
    */
 
+extern void *UArray2b_block(T array2b, int bx, int by);
+  /* return a pointer to the first cell of the block in column bx, row by
+     of blocks; its blocksize * blocksize cells follow it contiguously,
+     column by column, cells past the edge of the array included;
+     blocks are stored one after another in row-major order of blocks,
+     so block (bx + 1, by) starts blocksize * blocksize cells later;
+     index out of range is a checked run-time error
+   */
+
 extern void  UArray2b_map(T array2b, 
     void apply(int i, int j, T array2b, void *elem, void *cl), void *cl);
       /* visits every cell in one block before moving to another block */
 
+/* A cursor walks the blocks in the order they are stored without a
+   callback, so a kernel over a whole array is a plain loop the compiler
+   can see into:
+
+     UArray2b_FOR_EACH_BLOCK(array2b, cur) {
+       struct Pnm_rgb *cells = cur.cells;
+       for (int di = 0; di < cur.width; di++)
+         for (int dj = 0; dj < cur.height; dj++)
+           ... cells[di * cur.blocksize + dj] is cell (cur.i + di, cur.j + dj)
+     }
+
+   Only the first block costs a function call; stepping is arithmetic. */
+struct UArray2b_cursor {
+  void *cells;        /* first cell of the current block */
+  int bx, by;         /* its column and row in the matrix of blocks */
+  int i, j;           /* array coordinates of its top-left cell */
+  int width, height;  /* columns and rows of it inside the array; less
+                         than blocksize only in the last block column/row */
+  int blocksize;
+  int xblocks, yblocks, array_width, array_height;
+  size_t block_bytes;
+};
+
+static inline void UArray2b_cursor_clip_(struct UArray2b_cursor *cur) {
+  int b = cur->blocksize;
+  cur->i = cur->bx * b;
+  cur->j = cur->by * b;
+  cur->width  = cur->array_width  - cur->i < b ? cur->array_width  - cur->i : b;
+  cur->height = cur->array_height - cur->j < b ? cur->array_height - cur->j : b;
+}
+
+static inline struct UArray2b_cursor UArray2b_cursor_start(T array2b) {
+  struct UArray2b_cursor cur;
+  int b = UArray2b_blocksize(array2b);
+  cur.blocksize = b;
+  cur.array_width  = UArray2b_width(array2b);
+  cur.array_height = UArray2b_height(array2b);
+  cur.xblocks = (cur.array_width  + b - 1) / b;
+  cur.yblocks = (cur.array_height + b - 1) / b;
+  cur.block_bytes = (size_t)b * b * UArray2b_size(array2b);
+  cur.bx = 0;
+  cur.by = cur.xblocks == 0 ? cur.yblocks : 0;   /* nothing to visit */
+  cur.cells = cur.by < cur.yblocks ? UArray2b_block(array2b, 0, 0) : NULL;
+  UArray2b_cursor_clip_(&cur);
+  return cur;
+}
+
+static inline int UArray2b_cursor_done(const struct UArray2b_cursor *cur) {
+  return cur->by >= cur->yblocks;
+}
+
+static inline void UArray2b_cursor_next(struct UArray2b_cursor *cur) {
+  cur->cells = (char *)cur->cells + cur->block_bytes;
+  if (++cur->bx == cur->xblocks) {
+    cur->bx = 0;
+    cur->by++;
+  }
+  UArray2b_cursor_clip_(cur);
+}
+
+#define UArray2b_FOR_EACH_BLOCK(array2b, cur)                            \
+  for (struct UArray2b_cursor cur = UArray2b_cursor_start(array2b);     \
+       !UArray2b_cursor_done(&cur); UArray2b_cursor_next(&cur))
+
 /* it is a checked run-time error to pass a NULL T
    to any function in this interface */
 
@@ -0,0 +1,256 @@
+/* Filename:         workpool.c
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      WORKPOOL keeps nthreads - 1 helper threads waiting on a 
+ *                   condition variable between runs, so a pool can be reused
+ *                   for every batch of an image without creating threads 
+ *                   again. The thread that calls Workpool_run works on the 
+ *                   run's jobs alongside the helpers. 
+ * 
+ *                   Each run starts by giving every thread an equal, 
+ *                   contiguous range of jobs, which it works through in 
+ *                   order. A thread that runs out steals the top half of the
+ *                   largest range left, so threads that get cheap jobs pick
+ *                   up the slack of threads that get expensive ones.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "assert.h"
+#include "mem.h"
+#include "workpool.h"
+
+#define T Workpool_T
+
+/* jobs [next, end) that a thread has yet to do */
+struct range {
+        pthread_mutex_t lock;
+        unsigned next, end;
+};
+
+struct T {
+        unsigned nthreads;
+        pthread_t *helpers;     /* nthreads - 1 of them */
+        pthread_mutex_t lock;
+        pthread_cond_t start;   /* signalled when a run begins or on free */
+        pthread_cond_t done;    /* signalled when the last helper finishes */
+        unsigned run;           /* number of the current run */
+        unsigned busy;          /* helpers still working on the current run */
+        bool quit;
+
+        /* the current run; ranges[w] belongs to thread w, the caller of
+           Workpool_run being thread 0 */
+        Workpool_jobfun *job;
+        void *cl;
+        struct range *ranges;
+};
+
+/* what a helper thread needs to know */
+struct helper_cl {
+        T pool;
+        unsigned w;
+};
+
+static void *helper(void *vcl);
+static void do_jobs(T pool, unsigned w);
+static bool take_job(struct range *r, unsigned *k);
+static bool steal_jobs(T pool, unsigned w);
+
+
+T Workpool_new(unsigned nthreads)
+{
+        assert(nthreads > 0);
+        T pool;
+        NEW(pool);
+        pool->nthreads = nthreads;
+        pool->run = 0;
+        pool->busy = 0;
+        pool->quit = false;
+        pool->job = NULL;
+        pool->cl = NULL;
+        pthread_mutex_init(&pool->lock, NULL);
+        pthread_cond_init(&pool->start, NULL);
+        pthread_cond_init(&pool->done, NULL);
+
+        pool->ranges = ALLOC(nthreads * sizeof(struct range));
+        for (unsigned w = 0; w < nthreads; w++) {
+                pthread_mutex_init(&pool->ranges[w].lock, NULL);
+                pool->ranges[w].next = pool->ranges[w].end = 0;
+        }
+
+        pool->helpers = ALLOC(nthreads * sizeof(pthread_t));
+        for (unsigned i = 0; i + 1 < nthreads; i++) {
+                struct helper_cl *cl;
+                NEW(cl);
+                cl->pool = pool;
+                cl->w = i + 1;
+                int rc = pthread_create(&pool->helpers[i], NULL, helper, cl);
+                assert(rc == 0);
+        }
+        return pool;
+}
+
+
+void Workpool_free(T *pool)
+{
+        assert(pool && *pool);
+        T p = *pool;
+
+        pthread_mutex_lock(&p->lock);
+        p->quit = true;
+        pthread_cond_broadcast(&p->start);
+        pthread_mutex_unlock(&p->lock);
+        for (unsigned i = 0; i + 1 < p->nthreads; i++)
+                pthread_join(p->helpers[i], NULL);
+
+        for (unsigned w = 0; w < p->nthreads; w++)
+                pthread_mutex_destroy(&p->ranges[w].lock);
+        pthread_mutex_destroy(&p->lock);
+        pthread_cond_destroy(&p->start);
+        pthread_cond_destroy(&p->done);
+        FREE(p->ranges);
+        FREE(p->helpers);
+        FREE(*pool);
+}
+
+
+unsigned Workpool_threads(T pool)
+{
+        assert(pool);
+        return pool->nthreads;
+}
+
+
+void Workpool_run(T pool, unsigned njobs, Workpool_jobfun job, void *cl)
+{
+        assert(pool && job);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->job = job;
+        pool->cl = cl;
+        for (unsigned w = 0; w < pool->nthreads; w++) {
+                struct range *r = &pool->ranges[w];
+                pthread_mutex_lock(&r->lock);
+                r->next = (unsigned)((uint64_t)njobs * w / pool->nthreads);
+                r->end = (unsigned)((uint64_t)njobs * (w + 1) / pool->nthreads);
+                pthread_mutex_unlock(&r->lock);
+        }
+        pool->busy = pool->nthreads - 1;
+        pool->run++;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+
+        do_jobs(pool, 0);
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->busy > 0)
+                pthread_cond_wait(&pool->done, &pool->lock);
+        pthread_mutex_unlock(&pool->lock);
+}
+
+
+/* thread w does the jobs in its own range, stealing more when it runs out,
+ * until there are none left anywhere
+ */
+static void do_jobs(T pool, unsigned w)
+{
+        unsigned k;
+        do {
+                while (take_job(&pool->ranges[w], &k))
+                        pool->job(k, pool->cl);
+        } while (steal_jobs(pool, w));
+}
+
+
+/* takes the next job of a range, if it has one */
+static bool take_job(struct range *r, unsigned *k)
+{
+        bool found = false;
+        pthread_mutex_lock(&r->lock);
+        if (r->next < r->end) {
+                *k = r->next++;
+                found = true;
+        }
+        pthread_mutex_unlock(&r->lock);
+        return found;
+}
+
+
+/* moves the top half of the largest range left into thread w's own range;
+ * false if every range is empty. Only one range is locked at a time: the
+ * stolen jobs belong to thread w alone between the two locks.
+ */
+static bool steal_jobs(T pool, unsigned w)
+{
+        for (;;) {
+                unsigned victim = w;
+                unsigned most = 0;
+                for (unsigned v = 0; v < pool->nthreads; v++) {
+                        struct range *r = &pool->ranges[v];
+                        pthread_mutex_lock(&r->lock);
+                        unsigned left = r->end - r->next;
+                        pthread_mutex_unlock(&r->lock);
+                        if (left > most) {
+                                most = left;
+                                victim = v;
+                        }
+                }
+                if (most == 0)
+                        return false;
+
+                struct range *r = &pool->ranges[victim];
+                unsigned first = 0, end = 0;
+                pthread_mutex_lock(&r->lock);
+                if (r->next < r->end) {
+                        end = r->end;
+                        first = r->end - (r->end - r->next + 1) / 2;
+                        r->end = first;
+                }
+                pthread_mutex_unlock(&r->lock);
+
+                /* the victim may have emptied its range since we looked */
+                if (first < end) {
+                        struct range *mine = &pool->ranges[w];
+                        pthread_mutex_lock(&mine->lock);
+                        mine->next = first;
+                        mine->end = end;
+                        pthread_mutex_unlock(&mine->lock);
+                        return true;
+                }
+        }
+}
+
+
+/* body of a helper thread: sleeps until a run starts, works on it, reports
+ * that it is done, and goes back to sleep until the pool is freed
+ */
+static void *helper(void *vcl)
+{
+        struct helper_cl *cl = vcl;
+        T pool = cl->pool;
+        unsigned w = cl->w;
+        unsigned seen = 0;
+        FREE(cl);
+
+        pthread_mutex_lock(&pool->lock);
+        for (;;) {
+                while (!pool->quit && pool->run == seen)
+                        pthread_cond_wait(&pool->start, &pool->lock);
+                if (pool->quit)
+                        break;
+                seen = pool->run;
+                pthread_mutex_unlock(&pool->lock);
+
+                do_jobs(pool, w);
+
+                pthread_mutex_lock(&pool->lock);
+                if (--pool->busy == 0)
+                        pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+}
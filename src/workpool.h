@@ -0,0 +1,35 @@
+/* Filename:         workpool.h
+ * Authors:          Noah Epstein (nepste01), Katie Kurtz (kkurtz01)
+ * Last Modified:    Oct 17th, 2026
+ *
+ * Acknowledgements: See README.txt
+ *
+ * Description:      Interface for WORKPOOL, a pool of threads that runs 
+ *                   numbered jobs. 
+ */
+
+#ifndef WORKPOOL_INCLUDED
+#define WORKPOOL_INCLUDED
+
+#define T Workpool_T
+typedef struct T *T;
+
+typedef void Workpool_jobfun(unsigned job, void *cl);
+
+extern T    Workpool_new (unsigned nthreads);
+  /* new pool that runs jobs on nthreads threads, counting the thread that
+     calls Workpool_run; nthreads == 1 runs every job on the caller */
+extern void Workpool_free(T *pool);
+
+extern unsigned Workpool_threads(T pool);
+
+extern void Workpool_run (T pool, unsigned njobs, Workpool_jobfun job, 
+                                                                    void *cl);
+  /* calls job(k, cl) once for each k in [0, njobs), in no particular order
+     and on any of the pool's threads, and returns when all have finished */
+
+/* it is a checked run-time error to pass a NULL T
+   to any function in this interface */
+
+#undef T
+#endif